@@ -25,12 +25,117 @@
 #include "tier0/memdbgon.h"
 #include "plat.h"
 #include "entity/cbaseentity.h"
+#include "tier0/platform.h"
+#include <cstdio>
 
 extern CGlobalVars *gpGlobals;
 
-using SchemaKeyValueMap_t = CUtlMap<uint32_t, SchemaKey>;
-using SchemaTableMap_t = CUtlMap<uint32_t, SchemaKeyValueMap_t*>;
+// Open addressing table for the schema lookups, every field looked up so far is keyed by (class hash << 32) | member hash
+// and every class by its hash alone
+template <typename T>
+class CSchemaFlatTable
+{
+public:
+    const T *Find(uint64_t key) const
+    {
+        if (!m_pEntries)
+            return nullptr;
+
+        for (uint32_t i = Hash(key);; i = (i + 1) & (m_nCapacity - 1))
+        {
+            if (m_pEntries[i].m_key == key)
+                return &m_pEntries[i].m_value;
+
+            if (m_pEntries[i].m_key == 0)
+                return nullptr;
+        }
+    }
+
+    void Insert(uint64_t key, T value)
+    {
+        // Stay at most half full so misses end quickly
+        if ((m_nCount + 1) * 2 > m_nCapacity)
+            Grow();
+
+        uint32_t i = Hash(key);
 
+        while (m_pEntries[i].m_key != 0 && m_pEntries[i].m_key != key)
+            i = (i + 1) & (m_nCapacity - 1);
+
+        if (m_pEntries[i].m_key == 0)
+            m_nCount++;
+
+        m_pEntries[i] = {key, value};
+    }
+
+    int Count() const { return m_nCount; }
+    int Capacity() const { return m_nCapacity; }
+
+    // For walking the whole table, slots with a key of 0 are empty
+    uint64_t GetKey(int i) const { return m_pEntries[i].m_key; }
+
+private:
+    struct Entry_t
+    {
+        uint64_t m_key; // 0 when empty, both halves being 0 isn't going to happen with FNV
+        T m_value;
+    };
+
+    uint32_t Hash(uint64_t key) const { return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (m_nCapacity - 1); }
+
+    void Grow()
+    {
+        Entry_t *pOldEntries = m_pEntries;
+        uint32_t nOldCapacity = m_nCapacity;
+
+        m_nCapacity = m_nCapacity ? m_nCapacity * 2 : 1024;
+        m_pEntries = new Entry_t[m_nCapacity]();
+        m_nCount = 0;
+
+        for (uint32_t i = 0; i < nOldCapacity; i++)
+        {
+            if (pOldEntries[i].m_key != 0)
+                Insert(pOldEntries[i].m_key, pOldEntries[i].m_value);
+        }
+
+        delete[] pOldEntries;
+    }
+
+    Entry_t *m_pEntries = nullptr;
+    uint32_t m_nCapacity = 0;
+    uint32_t m_nCount = 0;
+};
+
+struct SchemaClass_t
+{
+    int16_t m_chainOffset;
+    bool m_bFound; // Classes the game no longer has still get an entry, so they only warn once
+};
+
+static CSchemaFlatTable<SchemaKey> g_schemaOffsets;
+static CSchemaFlatTable<SchemaClass_t> g_schemaClasses;
+
+static uint64_t MakeSchemaKey(uint32_t classKey, uint32_t memberKey)
+{
+    return ((uint64_t)classKey << 32) | memberKey;
+}
+
+// Filled during static init, so it can't be anything that needs a constructor
+static schema::FieldRegistration_t *g_pFieldRegistrations = nullptr;
+
+schema::FieldRegistration_t::FieldRegistration_t(const char *className, uint32_t classKey, const char *memberName, uint32_t memberKey) :
+    m_pszClassName(className), m_classKey(classKey), m_pszMemberName(memberName), m_memberKey(memberKey), m_pNext(g_pFieldRegistrations),
+    m_key{0, false}, m_chainOffset(0), m_bResolved(false)
+{
+    g_pFieldRegistrations = this;
+}
+
+void schema::FieldRegistration_t::Resolve()
+{
+    m_key = GetOffset(m_pszClassName, m_classKey, m_pszMemberName, m_memberKey);
+    m_chainOffset = FindChainOffset(m_pszClassName);
+    m_bResolved = true;
+}
 
 static bool IsFieldNetworked(SchemaClassFieldData_t& field)
 {
@@ -44,31 +149,52 @@ static bool IsFieldNetworked(SchemaClassFieldData_t& field)
     return false;
 }   
 
-static bool InitSchemaFieldsForClass(SchemaTableMap_t *tableMap, const char* className, uint32_t classKey)
+static int16_t FindChainOffset(SchemaClassInfoData_t *pClassInfo)
+{
+    do
+    {
+        SchemaClassFieldData_t* pFields = pClassInfo->m_pFields;
+        short fieldsSize = pClassInfo->m_nFieldCount;
+        for (int i = 0; i < fieldsSize; ++i)
+        {
+            SchemaClassFieldData_t& field = pFields[i];
+
+            if (V_strcmp(field.m_pszName, "__m_pChainEntity") == 0)
+            {
+                return field.m_nSingleInheritanceOffset;
+            }
+        }
+    } while ((pClassInfo = pClassInfo->m_pBaseClasses ? pClassInfo->m_pBaseClasses->m_pClass : nullptr) != nullptr);
+
+    return 0;
+}
+
+// Returns the class entry, adding it and all of its fields on first use
+static const SchemaClass_t *InitSchemaFieldsForClass(const char* className, uint32_t classKey)
 {
+    const SchemaClass_t *pClass = g_schemaClasses.Find(classKey);
+
+    if (pClass)
+        return pClass;
+
     CSchemaSystemTypeScope* pType = g_pSchemaSystem->FindTypeScopeForModule(MODULE_PREFIX "server" MODULE_EXT);
 
     if (!pType)
-        return false;
+        return nullptr;
 
     SchemaClassInfoData_t *pClassInfo = pType->FindDeclaredClass(className).Get();
 
     if (!pClassInfo)
     {
-        SchemaKeyValueMap_t *map = new SchemaKeyValueMap_t(0, 0, DefLessFunc(uint32_t));
-        tableMap->Insert(classKey, map);
+        g_schemaClasses.Insert(classKey, {0, false});
 
         Warning("InitSchemaFieldsForClass(): '%s' was not found!\n", className);
-        return false;
+        return g_schemaClasses.Find(classKey);
     }
 
     short fieldsSize = pClassInfo->m_nFieldCount;
     SchemaClassFieldData_t* pFields = pClassInfo->m_pFields;
 
-    SchemaKeyValueMap_t *keyValueMap = new SchemaKeyValueMap_t(0, 0, DefLessFunc(uint32_t));
-    keyValueMap->EnsureCapacity(fieldsSize);
-    tableMap->Insert(classKey, keyValueMap);
-
     for (int i = 0; i < fieldsSize; ++i)
     {
         SchemaClassFieldData_t& field = pFields[i];
@@ -77,60 +203,224 @@ static bool InitSchemaFieldsForClass(SchemaTableMap_t *tableMap, const char* cla
 		Message("%s::%s found at -> 0x%X - %llx\n", className, field.m_pszName, field.m_nSingleInheritanceOffset, &field);
 #endif
 
-        keyValueMap->Insert(hash_32_fnv1a_const(field.m_pszName), {field.m_nSingleInheritanceOffset, IsFieldNetworked(field)});
+        g_schemaOffsets.Insert(MakeSchemaKey(classKey, hash_32_fnv1a_const(field.m_pszName)), {field.m_nSingleInheritanceOffset, IsFieldNetworked(field)});
     }
 
-    return true;
+    g_schemaClasses.Insert(classKey, {FindChainOffset(pClassInfo), true});
+    return g_schemaClasses.Find(classKey);
 }
 
 int16_t schema::FindChainOffset(const char* className)
 {
-    CSchemaSystemTypeScope* pType = g_pSchemaSystem->FindTypeScopeForModule(MODULE_PREFIX "server" MODULE_EXT);
+    const SchemaClass_t *pClass = InitSchemaFieldsForClass(className, hash_32_fnv1a_const(className));
 
-    if (!pType)
-        return false;
+    return pClass ? pClass->m_chainOffset : 0;
+}
 
-    SchemaClassInfoData_t* pClassInfo = pType->FindDeclaredClass(className).Get();
+SchemaKey schema::GetOffset(const char* className, uint32_t classKey, const char* memberName, uint32_t memberKey)
+{
+    const SchemaKey *pKey = g_schemaOffsets.Find(MakeSchemaKey(classKey, memberKey));
 
-    do
+    if (pKey)
+        return *pKey;
+
+    const SchemaClass_t *pClass = InitSchemaFieldsForClass(className, classKey);
+
+    if (!pClass || !pClass->m_bFound)
+        return { 0, 0 };
+
+    pKey = g_schemaOffsets.Find(MakeSchemaKey(classKey, memberKey));
+
+    if (!pKey)
     {
-        SchemaClassFieldData_t* pFields = pClassInfo->m_pFields;
-        short fieldsSize = pClassInfo->m_nFieldCount;
-        for (int i = 0; i < fieldsSize; ++i)
+        Warning("schema::GetOffset(): '%s' was not found in '%s'!\n", memberName, className);
+        return { 0, 0 };
+    }
+
+    return *pKey;
+}
+
+// Offsets from the previous load, one "class::member offset" per line, so game updates that move fields show up in the report
+static const char *g_pszSchemaOffsetsPath = "/csgo/addons/cs2fixes/data/schema_offsets.txt";
+
+static void LoadPreviousOffsets(CUtlMap<uint64_t, int32> &previousOffsets)
+{
+    char szPath[MAX_PATH];
+    V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), g_pszSchemaOffsetsPath);
+
+    FILE *pFile = fopen(szPath, "r");
+
+    if (!pFile)
+        return;
+
+    char szField[512];
+    int offset;
+
+    while (fscanf(pFile, "%511s %d", szField, &offset) == 2)
+    {
+        char *pszMember = V_strstr(szField, "::");
+
+        if (!pszMember)
+            continue;
+
+        *pszMember = '\0';
+        previousOffsets.InsertOrReplace(MakeSchemaKey(hash_32_fnv1a_const(szField), hash_32_fnv1a_const(pszMember + 2)), offset);
+    }
+
+    fclose(pFile);
+}
+
+void schema::ResolveAllFields()
+{
+    double flStart = Plat_FloatTime();
+
+    CUtlMap<uint64_t, int32> previousOffsets(0, 0, DefLessFunc(uint64_t));
+    LoadPreviousOffsets(previousOffsets);
+
+    char szPath[MAX_PATH];
+    V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), g_pszSchemaOffsetsPath);
+    FILE *pFile = fopen(szPath, "w");
+
+    int iFields = 0;
+    int iClasses = 0;
+    int iMissingClasses = 0;
+    int iMissingFields = 0;
+    int iChangedFields = 0;
+
+    for (FieldRegistration_t *pField = g_pFieldRegistrations; pField; pField = pField->m_pNext)
+    {
+        iFields++;
+
+        const SchemaClass_t *pClass = g_schemaClasses.Find(pField->m_classKey);
+
+        if (!pClass)
         {
-            SchemaClassFieldData_t& field = pFields[i];
+            iClasses++;
 
-            if (V_strcmp(field.m_pszName, "__m_pChainEntity") == 0)
+            // Warns by itself when the class is gone
+            pClass = InitSchemaFieldsForClass(pField->m_pszClassName, pField->m_classKey);
+
+            if (pClass && !pClass->m_bFound)
+                iMissingClasses++;
+        }
+
+        // Every field counts as resolved from here on, a missing one keeps offset 0 like the lazy lookup used to give it
+        pField->m_bResolved = true;
+
+        if (!pClass)
+            continue;
+
+        const SchemaKey *pKey = g_schemaOffsets.Find(MakeSchemaKey(pField->m_classKey, pField->m_memberKey));
+
+        pField->m_key = pKey ? *pKey : SchemaKey{0, false};
+        pField->m_chainOffset = pClass->m_chainOffset;
+
+        if (!pKey)
+        {
+            // Fields of a missing class were already covered by the class warning
+            if (pClass->m_bFound)
             {
-                return field.m_nSingleInheritanceOffset;
+                Warning("schema::ResolveAllFields(): '%s' was not found in '%s'!\n", pField->m_pszMemberName, pField->m_pszClassName);
+                iMissingFields++;
             }
+
+            continue;
         }
-    } while ((pClassInfo = pClassInfo->m_pBaseClasses ? pClassInfo->m_pBaseClasses->m_pClass : nullptr) != nullptr);
 
-    return 0;
+        int32 offset = pKey->offset;
+        auto previousIndex = previousOffsets.Find(MakeSchemaKey(pField->m_classKey, pField->m_memberKey));
+
+        if (previousOffsets.IsValidIndex(previousIndex) && previousOffsets[previousIndex] != offset)
+        {
+            Warning("schema::ResolveAllFields(): %s::%s moved from 0x%X to 0x%X since the last load\n",
+                pField->m_pszClassName, pField->m_pszMemberName, previousOffsets[previousIndex], offset);
+            iChangedFields++;
+        }
+
+        if (pFile)
+            fprintf(pFile, "%s::%s %d\n", pField->m_pszClassName, pField->m_pszMemberName, offset);
+    }
+
+    if (pFile)
+        fclose(pFile);
+
+    Message("Resolved %d schema fields from %d classes in %.2f ms: %d missing classes, %d missing fields, %d changed since the last load\n",
+        iFields, iClasses, (Plat_FloatTime() - flStart) * 1000.0, iMissingClasses, iMissingFields, iChangedFields);
 }
 
-SchemaKey schema::GetOffset(const char* className, uint32_t classKey, const char* memberName, uint32_t memberKey)
+// Every class our headers declare, all of their fields and whether we use them, so game updates can be diffed against a previous dump
+CON_COMMAND_F(cs2f_schema_dump, "Write the live layout of every schema class CS2Fixes uses to data/schema_dump.txt", FCVAR_LINKED_CONCOMMAND | FCVAR_SPONLY)
 {
-	static SchemaTableMap_t schemaTableMap(0, 0, DefLessFunc(uint32_t));
-	int16_t tableMapIndex = schemaTableMap.Find(classKey);
-    if (!schemaTableMap.IsValidIndex(tableMapIndex))
-    {
-        if (InitSchemaFieldsForClass(&schemaTableMap, className, classKey))
-            return GetOffset(className, classKey, memberName, memberKey);
+    CSchemaSystemTypeScope *pType = g_pSchemaSystem->FindTypeScopeForModule(MODULE_PREFIX "server" MODULE_EXT);
 
-        return { 0, 0 };
+    if (!pType)
+        return;
+
+    char szPath[MAX_PATH];
+    V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), "/csgo/addons/cs2fixes/data/schema_dump.txt");
+
+    FILE *pFile = fopen(szPath, "w");
+
+    if (!pFile)
+    {
+        Message("Couldn't open %s for writing\n", szPath);
+        return;
     }
 
-    SchemaKeyValueMap_t *tableMap = schemaTableMap[tableMapIndex];
-	int16_t memberIndex = tableMap->Find(memberKey);
-    if (!tableMap->IsValidIndex(memberIndex))
+    CUtlMap<uint64_t, bool> usedFields(0, 0, DefLessFunc(uint64_t));
+    CUtlMap<uint32_t, bool> dumpedClasses(0, 0, DefLessFunc(uint32_t));
+
+    for (schema::FieldRegistration_t *pField = g_pFieldRegistrations; pField; pField = pField->m_pNext)
+        usedFields.InsertOrReplace(MakeSchemaKey(pField->m_classKey, pField->m_memberKey), true);
+
+    fprintf(pFile, "# class <name> <chain offset>\n# field <class> <name> <offset> <networked> <used>\n");
+
+    int iClasses = 0;
+    int iFields = 0;
+
+    for (schema::FieldRegistration_t *pField = g_pFieldRegistrations; pField; pField = pField->m_pNext)
     {
-        Warning("schema::GetOffset(): '%s' was not found in '%s'!\n", memberName, className);
-        return { 0, 0 };
+        if (dumpedClasses.IsValidIndex(dumpedClasses.Find(pField->m_classKey)))
+            continue;
+
+        dumpedClasses.Insert(pField->m_classKey, true);
+
+        SchemaClassInfoData_t *pClassInfo = pType->FindDeclaredClass(pField->m_pszClassName).Get();
+
+        if (!pClassInfo)
+            continue;
+
+        iClasses++;
+        fprintf(pFile, "class %s %d\n", pField->m_pszClassName, FindChainOffset(pClassInfo));
+
+        for (int i = 0; i < pClassInfo->m_nFieldCount; i++)
+        {
+            SchemaClassFieldData_t &field = pClassInfo->m_pFields[i];
+            bool bUsed = usedFields.IsValidIndex(usedFields.Find(MakeSchemaKey(pField->m_classKey, hash_32_fnv1a_const(field.m_pszName))));
+
+            iFields++;
+            fprintf(pFile, "field %s %s %d %d %d\n", pField->m_pszClassName, field.m_pszName, field.m_nSingleInheritanceOffset,
+                IsFieldNetworked(field), bUsed);
+        }
     }
 
-    return tableMap->Element(memberIndex);
+    fclose(pFile);
+
+    Message("Dumped %d fields from %d classes to %s\n", iFields, iClasses, szPath);
+}
+
+const SchemaKey *schema::FindLoadedField(uint64_t key)
+{
+    return g_schemaOffsets.Find(key);
+}
+
+void schema::GetLoadedFields(CUtlVector<uint64_t> &keys)
+{
+    for (int i = 0; i < g_schemaOffsets.Capacity(); i++)
+    {
+        if (g_schemaOffsets.GetKey(i))
+            keys.AddToTail(g_schemaOffsets.GetKey(i));
+    }
 }
 
 void EntityNetworkStateChanged(uintptr_t entityInstance, uint nOffset)
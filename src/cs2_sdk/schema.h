@@ -32,6 +32,7 @@
 
 #include "../addresses.h"
 #include "tier0/dbg.h"
+#include "tier1/utlvector.h"
 #include "const.h"
 #include "virtual.h"
 #include "stdint.h"
@@ -43,6 +44,42 @@ struct SchemaKey
 	bool networked;
 };
 
+namespace schema
+{
+	struct FieldRegistration_t
+	{
+		FieldRegistration_t(const char *className, uint32_t classKey, const char *memberName, uint32_t memberKey);
+
+		// Filled for every field by ResolveAllFields in Load, the lookup here only runs for anything touched before that
+		const SchemaKey &GetKey()
+		{
+			if (!m_bResolved)
+				Resolve();
+
+			return m_key;
+		}
+
+		int16_t GetChainOffset()
+		{
+			if (!m_bResolved)
+				Resolve();
+
+			return m_chainOffset;
+		}
+
+		void Resolve();
+
+		const char *m_pszClassName;
+		uint32_t m_classKey;
+		const char *m_pszMemberName;
+		uint32_t m_memberKey;
+		FieldRegistration_t *m_pNext;
+		SchemaKey m_key;
+		int16_t m_chainOffset;
+		bool m_bResolved;
+	};
+}
+
 void EntityNetworkStateChanged(uintptr_t entityInstance, uint nOffset);
 void ChainNetworkStateChanged(uintptr_t networkVarChainer, uint nLocalOffset);
 
@@ -61,18 +98,20 @@ inline constexpr uint64_t hash_64_fnv1a_const(const char *const str, const uint6
 	return (str[0] == '\0') ? value : hash_64_fnv1a_const(&str[1], (value ^ uint64_t(str[0])) * prime_64_const);
 }
 
+// Every declared field adds itself to a list at static init, so schema::ResolveAllFields can look them all up on load
+// The accessors then read the offset straight from here, without a function-local static and its guard
+#define SCHEMA_FIELD_REGISTRATION(varName)																					\
+		static inline schema::FieldRegistration_t m_registration{																\
+			ThisClassName, hash_32_fnv1a_const(ThisClassName), #varName, hash_32_fnv1a_const(#varName)};
+
 #define SCHEMA_FIELD_OFFSET(type, varName, extra_offset)																	\
 	class varName##_prop																									\
 	{																														\
 	public:																													\
+		SCHEMA_FIELD_REGISTRATION(varName)																					\
 		std::add_lvalue_reference_t<type> Get()																				\
 		{																													\
-			static constexpr auto datatable_hash = hash_32_fnv1a_const(ThisClassName);										\
-			static constexpr auto prop_hash = hash_32_fnv1a_const(#varName);												\
-																															\
-			static const auto m_key =																						\
-				schema::GetOffset(ThisClassName, datatable_hash, #varName, prop_hash);										\
-																															\
+			const SchemaKey &m_key = m_registration.GetKey();																\
 			static const size_t offset = offsetof(ThisClass, varName);														\
 			ThisClass *pThisClass = (ThisClass *)((byte *)this - offset);													\
 																															\
@@ -81,21 +120,14 @@ inline constexpr uint64_t hash_64_fnv1a_const(const char *const str, const uint6
 		}																													\
 		void Set(type val)																									\
 		{																													\
-			static constexpr auto datatable_hash = hash_32_fnv1a_const(ThisClassName);										\
-			static constexpr auto prop_hash = hash_32_fnv1a_const(#varName);												\
-																															\
-			static const auto m_key =																						\
-				schema::GetOffset(ThisClassName, datatable_hash, #varName, prop_hash);										\
-																															\
-			static const auto m_chain =																						\
-				schema::FindChainOffset(ThisClassName);																		\
+			const SchemaKey &m_key = m_registration.GetKey();																\
+			const int16_t m_chain = m_registration.GetChainOffset();														\
 																															\
 			static const size_t offset = offsetof(ThisClass, varName);														\
 			ThisClass *pThisClass = (ThisClass *)((byte *)this - offset);													\
 																															\
 			if (m_chain != 0 && m_key.networked)																			\
 			{																												\
-				DevMsg("Found chain offset %d for %s::%s\n", m_chain, ThisClassName, #varName);								\
 				ChainNetworkStateChanged((uintptr_t)(pThisClass) + m_chain, m_key.offset + extra_offset);	                \
 			}																												\
 			else if(m_key.networked)																						\
@@ -120,14 +152,10 @@ inline constexpr uint64_t hash_64_fnv1a_const(const char *const str, const uint6
 	class varName##_prop																									\
 	{																														\
 	public:																													\
+		SCHEMA_FIELD_REGISTRATION(varName)																					\
 		type *Get()																											\
 		{																													\
-			static constexpr auto datatable_hash = hash_32_fnv1a_const(ThisClassName);										\
-			static constexpr auto prop_hash = hash_32_fnv1a_const(#varName);												\
-																															\
-			static const auto m_key =																						\
-				schema::GetOffset(ThisClassName, datatable_hash, #varName, prop_hash);										\
-																															\
+			const SchemaKey &m_key = m_registration.GetKey();																\
 			static const size_t offset = offsetof(ThisClass, varName);														\
 			ThisClass *pThisClass = (ThisClass *)((byte *)this - offset);													\
 																															\
@@ -151,6 +179,13 @@ namespace schema
 {
 	int16_t FindChainOffset(const char *className);
 	SchemaKey GetOffset(const char *className, uint32_t classKey, const char *memberName, uint32_t memberKey);
+
+	// Resolves every registered field up front and reports missing ones, plus offsets that moved since the last load
+	void ResolveAllFields();
+
+	// For cs2f_bench_schema, reads the table as it is without loading any class
+	const SchemaKey *FindLoadedField(uint64_t key);
+	void GetLoadedFields(CUtlVector<uint64_t> &keys);
 }
 
 #define DECLARE_SCHEMA_CLASS_BASE(className, isStruct)			\
@@ -36,9 +36,17 @@
 #include "networkstringtabledefs.h"
 #include "gamesystem.h"
 #include "ctimer.h"
+#include "task.h"
+#include "framebudget.h"
+#include "jobscheduler.h"
 #include "entities.h"
 #include "playermanager.h"
+#include "playersnapshot.h"
+#include "transmit.h"
+#include "proximity.h"
+#include "postevent.h"
 #include <entity.h>
+#include <bit>
 #include "adminsystem.h"
 #include "commands.h"
 #include "eventlistener.h"
@@ -146,6 +154,11 @@ CGameEntitySystem *GameEntitySystem()
 	return *reinterpret_cast<CGameEntitySystem **>((uintptr_t)(g_pGameResourceServiceServer) + offset);
 }
 
+static void DumpTimersToFile();
+static void FilterFireBullets(PostEvent_t &event);
+static void FilterWorldDecal(PostEvent_t &event);
+static void FilterLegacyGameEvent(PostEvent_t &event);
+
 PLUGIN_EXPOSE(CS2Fixes, g_CS2Fixes);
 bool CS2Fixes::Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool late)
 {
@@ -191,6 +204,13 @@ bool CS2Fixes::Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool
 	int offset = g_GameConfig->GetOffset("IGameTypes_CreateWorkshopMapGroup");
 	SH_MANUALHOOK_RECONFIGURE(CreateWorkshopMapGroup, offset, 0, 0);
 
+	// Look up every schema field now rather than the first time some rarely used entity gets touched mid round
+	schema::ResolveAllFields();
+
+	PostEvent_AddFilter(GE_FireBulletsId, FilterFireBullets);
+	PostEvent_AddFilter(TE_WorldDecalId, FilterWorldDecal);
+	PostEvent_AddFilter(GE_Source1LegacyGameEvent, FilterLegacyGameEvent);
+
 	SH_ADD_HOOK(IServerGameDLL, GameFrame, g_pSource2Server, SH_MEMBER(this, &CS2Fixes::Hook_GameFramePost), true);
 	SH_ADD_HOOK(IServerGameDLL, GameServerSteamAPIActivated, g_pSource2Server, SH_MEMBER(this, &CS2Fixes::Hook_GameServerSteamAPIActivated), false);
 	SH_ADD_HOOK(IServerGameDLL, GameServerSteamAPIDeactivated, g_pSource2Server, SH_MEMBER(this, &CS2Fixes::Hook_GameServerSteamAPIDeactivated), false);
@@ -313,29 +333,23 @@ bool CS2Fixes::Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool
 	g_pEntityListener = new CEntityListener();
 	g_pIdleSystem = new CIdleSystem();
 	g_pPanoramaVoteHandler = new CPanoramaVoteHandler();
+	g_pJobScheduler = new CJobScheduler();
+	g_pPlayerSnapshot = new CPlayerSnapshot();
 
 	RegisterWeaponCommands();
 
-	// Check hide distance
-	new CTimer(0.5f, true, true, []()
-	{
-		g_playerManager->CheckHideDistances();
-		return 0.5f;
-	});
-
 	// Check for the expiration of infractions like mutes or gags
-	new CTimer(30.0f, true, true, []()
-	{
-		g_playerManager->CheckInfractions();
-		return 30.0f;
-	});
+	g_pJobScheduler->AddPlayerJob("CheckInfractions", 30.0f, true,
+		[](int iSlot) { g_playerManager->CheckInfractions(iSlot); },
+		[]() { g_pAdminSystem->SaveInfractions(); });
 
 	// Check for idle players and kick them if permitted by cs2f_idle_kick_* 'convars'
-	new CTimer(5.0f, true, true, []()
-	{
-		g_pIdleSystem->CheckForIdleClients();
-		return 5.0f;
-	});
+	g_pJobScheduler->AddJob("CheckForIdleClients", 5.0f, true, []() { g_pIdleSystem->CheckForIdleClients(); });
+
+	g_pJobScheduler->AddPlayerJob("InfiniteAmmo", 5.0f, true, [](int iSlot) { g_playerManager->InfiniteAmmoThink(iSlot); });
+
+	g_pJobScheduler->AddJob("DumpTimersToFile", 60.0f, true, DumpTimersToFile);
+	g_pJobScheduler->AddJob("DumpBandwidthToFile", 60.0f, true, PostEvent_DumpBandwidthToFile);
 
 	// run our cfg
 	g_pEngineServer2->ServerCommand("exec cs2fixes/cs2fixes");
@@ -414,6 +428,12 @@ bool CS2Fixes::Unload(char *error, size_t maxlen)
 	if (g_pPanoramaVoteHandler)
 		delete g_pPanoramaVoteHandler;
 
+	if (g_pJobScheduler)
+		delete g_pJobScheduler;
+
+	if (g_pPlayerSnapshot)
+		delete g_pPlayerSnapshot;
+
 	if (g_iCGamePlayerEquipUseId != -1)
 		SH_REMOVE_HOOK_ID(g_iCGamePlayerEquipUseId);
 
@@ -423,6 +443,7 @@ bool CS2Fixes::Unload(char *error, size_t maxlen)
 void CS2Fixes::Hook_DispatchConCommand(ConCommandHandle cmdHandle, const CCommandContext& ctx, const CCommand& args)
 {
 	VPROF_BUDGET("CS2Fixes::Hook_DispatchConCommand", "ConCommands");
+	FRAME_PROBE("CS2Fixes::Hook_DispatchConCommand");
 
 	if (!g_pEntitySystem)
 		RETURN_META(MRES_IGNORED);
@@ -520,6 +541,13 @@ void CS2Fixes::Hook_StartupServer(const GameSessionConfiguration_t& config, ISou
 	if(g_bHasTicked)
 		RemoveMapTimers();
 
+	FrameBudget_Reset();
+
+	RemoveMapTasks();
+	g_pJobScheduler->RemoveMapJobs();
+	g_pPlayerSnapshot->Clear();
+	Transmit_OnMapChange();
+
 	g_bHasTicked = false;
 
 	RegisterEventListeners();
@@ -557,57 +585,348 @@ void CS2Fixes::Hook_GameServerSteamAPIDeactivated()
 	RETURN_META(MRES_IGNORED);
 }
 
-void CS2Fixes::Hook_PostEvent(CSplitScreenSlot nSlot, bool bLocalOnly, int nClientCount, const uint64* clients,
-	INetworkMessageInternal* pEvent, const CNetMessage* pData, unsigned long nSize, NetChannelBufType_t bufType)
+FAKE_FLOAT_CVAR(cs2f_firebullets_audible_distance, "Only send gunshots to players within this many units of the shooter, spectators use who they're watching, 0 to disable", g_flFireBulletsAudibleDistance, 0.0f, false)
+FAKE_FLOAT_CVAR(cs2f_decal_distance, "Only send world decals to players within this many units of them, spectators use who they're watching, 0 to disable", g_flDecalDistance, 0.0f, false)
+FAKE_FLOAT_CVAR(cs2f_decal_rate, "How many world decals per second each player can receive, 0 to disable", g_flDecalRate, 0.0f, false)
+FAKE_FLOAT_CVAR(cs2f_decal_burst, "How many world decals each player can receive at once before cs2f_decal_rate kicks in", g_flDecalBurst, 16.0f, false)
+
+// Removes clients whose view origin is farther than flDistance from vecOrigin, those without one are kept
+static uint64 FilterByDistance(uint64 nClients, const CMsgVector &origin, float flDistance)
+{
+	uint64 nViewMask = g_pPlayerSnapshot->GetViewMask();
+	uint64 nInRange = Proximity_Query(g_pPlayerSnapshot->m_flViewX, g_pPlayerSnapshot->m_flViewY, g_pPlayerSnapshot->m_flViewZ,
+		gpGlobals->maxClients, Vector(origin.x(), origin.y(), origin.z()), flDistance, nViewMask & nClients);
+
+	return nClients & (nInRange | ~nViewMask);
+}
+
+// Token bucket per client so a wall of rifles can't flood everyone's buffers with decals
+static float g_flDecalTokens[MAXPLAYERS];
+static float g_flLastDecalRefill = 0.0f;
+
+static uint64 RateLimitDecals(uint64 nClients)
+{
+	float flBurst = MAX(g_flDecalBurst, 1.0f);
+	float flElapsed = gpGlobals->curtime - g_flLastDecalRefill;
+
+	// curtime starts over on map change, so just fill everyone back up
+	if (flElapsed < 0.0f)
+		flElapsed = flBurst / g_flDecalRate;
+
+	if (flElapsed > 0.0f)
+	{
+		for (int i = 0; i < MAXPLAYERS; i++)
+			g_flDecalTokens[i] = MIN(g_flDecalTokens[i] + flElapsed * g_flDecalRate, flBurst);
+
+		g_flLastDecalRefill = gpGlobals->curtime;
+	}
+
+	uint64 nAllowed = 0;
+
+	for (uint64 nLeft = nClients; nLeft; nLeft &= nLeft - 1)
+	{
+		int i = std::countr_zero(nLeft);
+
+		if (g_flDecalTokens[i] >= 1.0f)
+		{
+			g_flDecalTokens[i] -= 1.0f;
+			nAllowed |= (uint64)1 << i;
+		}
+	}
+
+	return nAllowed;
+}
+
+// Posts the silencesound variant of a bullet to nClients
+// Creating a new event object requires us to include the protobuf c files which I didn't feel like doing yet
+// So instead just edit the event in place and reset later, which is also far cheaper than copying the message per bullet
+static void RepostSilencedFireBullets(const PostEvent_t &event, uint64 nClients)
 {
-	// Message( "Hook_PostEvent(%d, %d, %d, %lli)\n", nSlot, bLocalOnly, nClientCount, clients );
 	// Need to explicitly get a pointer to the right function as it's overloaded and SH_CALL can't resolve that
 	static void (IGameEventSystem::*PostEventAbstract)(CSplitScreenSlot, bool, int, const uint64 *,
 					INetworkMessageInternal *, const CNetMessage *, unsigned long, NetChannelBufType_t) = &IGameEventSystem::PostEventAbstract;
 
-	NetMessageInfo_t *info = pEvent->GetNetMessageInfo();
+	auto msg = const_cast<CNetMessage*>(event.m_pData)->ToPB<CMsgTEFireBullets>();
+
+	int32_t weapon_id = msg->weapon_id();
+	int32_t sound_type = msg->sound_type();
+	int32_t item_def_index = msg->item_def_index();
+
+	// original weapon_id will override new settings if not removed
+	msg->set_weapon_id(0);
+	msg->set_sound_type(9);
+	msg->set_item_def_index(61); // weapon_usp_silencer
+
+	SH_CALL(g_gameEventSystem, PostEventAbstract)
+	(event.m_nSlot, event.m_bLocalOnly, event.m_nClientCount, &nClients, event.m_pEvent, msg, event.m_nSize, event.m_bufType);
+
+	PostEvent_RecordRepost(event, nClients);
+
+	msg->set_weapon_id(weapon_id);
+	msg->set_sound_type(sound_type);
+	msg->set_item_def_index(item_def_index);
+}
+
+// Takes everyone using silencesound or stopsound off the original, returns who gets the silenced repost instead
+static uint64 SplitSilencedClients(uint64 &nClients, uint64 nStopSound, uint64 nSilenceSound)
+{
+	uint64 nSilencedClients = nClients & nSilenceSound;
+	nClients &= ~(nStopSound | nSilenceSound);
+
+	return nSilencedClients;
+}
 
-	if (g_bEnableStopSound && info->m_MessageId == GE_FireBulletsId)
+static void FilterFireBullets(PostEvent_t &event)
+{
+	// Anyone without a known view origin (free roaming spectators) still hears everything
+	if (g_flFireBulletsAudibleDistance > 0.0f)
 	{
-		if (g_playerManager->GetSilenceSoundMask())
-		{
-			// Post the silenced sound to those who use silencesound
-			// Creating a new event object requires us to include the protobuf c files which I didn't feel like doing yet
-			// So instead just edit the event in place and reset later
-			auto msg = const_cast<CNetMessage*>(pData)->ToPB<CMsgTEFireBullets>();
+		auto msg = const_cast<CNetMessage*>(event.m_pData)->ToPB<CMsgTEFireBullets>();
+		*event.m_pClients = FilterByDistance(*event.m_pClients, msg->origin(), g_flFireBulletsAudibleDistance);
+	}
 
-			int32_t weapon_id = msg->weapon_id();
-			int32_t sound_type = msg->sound_type();
-			int32_t item_def_index = msg->item_def_index();
+	if (!g_bEnableStopSound)
+		return;
 
-			// original weapon_id will override new settings if not removed
-			msg->set_weapon_id(0);
-			msg->set_sound_type(9);
-			msg->set_item_def_index(61); // weapon_usp_silencer
+	uint64 nSilencedClients = SplitSilencedClients(*event.m_pClients, g_playerManager->GetStopSoundMask(), g_playerManager->GetSilenceSoundMask());
 
-			uint64 clientMask = *(uint64 *)clients & g_playerManager->GetSilenceSoundMask();
+	// Post the silenced sound to those who use silencesound, skipped entirely when none of them would get this one
+	if (nSilencedClients)
+	{
+		FRAME_PROBE("CS2Fixes::Hook_PostEvent::SilencedFireBullets");
+		RepostSilencedFireBullets(event, nSilencedClients);
+	}
+}
 
-			SH_CALL(g_gameEventSystem, PostEventAbstract)
-			(nSlot, bLocalOnly, nClientCount, &clientMask, pEvent, msg, nSize, bufType);
+static void FilterWorldDecal(PostEvent_t &event)
+{
+	*event.m_pClients &= ~g_playerManager->GetStopDecalsMask();
 
-			msg->set_weapon_id(weapon_id);
-			msg->set_sound_type(sound_type);
-			msg->set_item_def_index(item_def_index);
-		}
+	if (g_flDecalDistance > 0.0f)
+	{
+		auto msg = const_cast<CNetMessage*>(event.m_pData)->ToPB<CMsgTEWorldDecal>();
+		*event.m_pClients = FilterByDistance(*event.m_pClients, msg->origin(), g_flDecalDistance);
+	}
+
+	// Only spend tokens on decals that would actually be sent
+	if (g_flDecalRate > 0.0f)
+		*event.m_pClients = RateLimitDecals(*event.m_pClients);
+}
+
+static void FilterLegacyGameEvent(PostEvent_t &event)
+{
+	if (g_bEnableLeader)
+		Leader_PostEventAbstract_Source1LegacyGameEvent(event.m_pClients, event.m_pData);
+}
+
+void CS2Fixes::Hook_PostEvent(CSplitScreenSlot nSlot, bool bLocalOnly, int nClientCount, const uint64* clients,
+	INetworkMessageInternal* pEvent, const CNetMessage* pData, unsigned long nSize, NetChannelBufType_t bufType)
+{
+	FRAME_PROBE("CS2Fixes::Hook_PostEvent");
+
+	// Message( "Hook_PostEvent(%d, %d, %d, %lli)\n", nSlot, bLocalOnly, nClientCount, clients );
+	// Filters edit the client mask in place
+	PostEvent_t event = {nSlot, bLocalOnly, nClientCount, const_cast<uint64 *>(clients), pEvent, pData, nSize, bufType};
+	PostEvent_Dispatch(event);
+}
+
+// Nothing is posted, the engine's side of the repost is the same for any way of building the silenced message
+CON_COMMAND_F(cs2f_bench_firebullets, "Time the FireBullets silencesound filter on made up recipient masks, against building the silenced variant as a copy, usage: cs2f_bench_firebullets [iterations]", FCVAR_LINKED_CONCOMMAND | FCVAR_SPONLY)
+{
+	int iIterations = args.ArgC() < 2 ? 100000 : V_StringToInt32(args[1], 100000);
 
-		// Filter out people using stop/silence sound from the original event
-		*(uint64 *)clients &= ~g_playerManager->GetStopSoundMask();
-		*(uint64 *)clients &= ~g_playerManager->GetSilenceSoundMask();
+	if (iIterations < 1)
+		iIterations = 1;
+
+	// Fixed seed so runs are comparable, every bullet goes to a random half of 64 players and about one in eight uses silencesound
+	uint32 iSeed = 12345;
+	auto Random = [&iSeed]() { iSeed = iSeed * 1664525 + 1013904223; return (uint64)(iSeed >> 8); };
+
+	const int nMasks = 256;
+	uint64 nRecipients[nMasks];
+	uint64 nSilenceSound = 0;
+	uint64 nStopSound = 0;
+
+	for (int i = 0; i < nMasks; i++)
+		nRecipients[i] = (Random() << 40) ^ (Random() << 20) ^ Random();
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		uint64 nRoll = Random() % 16;
+
+		if (nRoll < 2)
+			nSilenceSound |= (uint64)1 << i;
+		else if (nRoll == 2)
+			nStopSound |= (uint64)1 << i;
 	}
-	else if (info->m_MessageId == TE_WorldDecalId)
+
+	CMsgTEFireBullets msg;
+	msg.mutable_origin()->set_x(1024.0f);
+	msg.mutable_origin()->set_y(-512.0f);
+	msg.mutable_origin()->set_z(64.0f);
+	msg.mutable_angles()->set_x(3.5f);
+	msg.mutable_angles()->set_y(90.0f);
+	msg.set_weapon_id(7);
+	msg.set_seed(1234);
+	msg.set_player(5);
+	msg.set_inaccuracy(0.01f);
+	msg.set_recoil_index(3.0f);
+	msg.set_spread(0.002f);
+	msg.set_sound_type(2);
+	msg.set_item_def_index(7);
+
+	int iReposts = 0;
+	double flStart = Plat_FloatTime();
+
+	// What FilterFireBullets does around the repost, masks plus the field swap and restore
+	for (int i = 0; i < iIterations; i++)
 	{
-		*(uint64 *)clients &= ~g_playerManager->GetStopDecalsMask();
+		uint64 nClients = nRecipients[i & (nMasks - 1)];
+		msg.set_seed(msg.seed() + 1);
+
+		if (!SplitSilencedClients(nClients, nStopSound, nSilenceSound))
+			continue;
+
+		int32_t weapon_id = msg.weapon_id();
+		int32_t sound_type = msg.sound_type();
+		int32_t item_def_index = msg.item_def_index();
+
+		msg.set_weapon_id(0);
+		msg.set_sound_type(9);
+		msg.set_item_def_index(61);
+
+		iReposts++;
+
+		msg.set_weapon_id(weapon_id);
+		msg.set_sound_type(sound_type);
+		msg.set_item_def_index(item_def_index);
 	}
-	else if (info->m_MessageId == GE_Source1LegacyGameEvent)
+
+	double flSwapTime = Plat_FloatTime() - flStart;
+
+	// The same with the silenced variant built into a preallocated message instead, as the original message stays untouched
+	CMsgTEFireBullets silencedMsg;
+	flStart = Plat_FloatTime();
+
+	for (int i = 0; i < iIterations; i++)
 	{
-		if (g_bEnableLeader)
-			Leader_PostEventAbstract_Source1LegacyGameEvent(clients, pData);
+		uint64 nClients = nRecipients[i & (nMasks - 1)];
+		msg.set_seed(msg.seed() + 1);
+
+		if (!SplitSilencedClients(nClients, nStopSound, nSilenceSound))
+			continue;
+
+		silencedMsg.CopyFrom(msg);
+		silencedMsg.set_weapon_id(0);
+		silencedMsg.set_sound_type(9);
+		silencedMsg.set_item_def_index(61);
 	}
+
+	double flCopyTime = Plat_FloatTime() - flStart;
+
+	Message("cs2f_bench_firebullets: %d bullets, %d with a silenced repost (checksum %u)\n", iIterations, iReposts, msg.seed() + silencedMsg.seed());
+	Message("  masks + swap/restore: %.1f ns per bullet\n", flSwapTime * 1000000000.0 / iIterations);
+	Message("  masks + copy:         %.1f ns per bullet\n", flCopyTime * 1000000000.0 / iIterations);
+}
+
+// The accessors before the flat table kept their key in a function-local static filled from two levels of CUtlMap
+#define BENCH_OLD_ACCESSOR(type, className, varName)																		\
+	[](void *pThis) -> type {																								\
+		static const auto m_key = schema::GetOffset(#className, hash_32_fnv1a_const(#className), #varName, hash_32_fnv1a_const(#varName));	\
+		return *reinterpret_cast<type *>((uintptr_t)pThis + m_key.offset);												\
+	}
+
+CON_COMMAND_F(cs2f_bench_schema, "Time schema lookups and accessors for m_iHealth, m_iTeamNum and m_pMovementServices the old and current way, usage: cs2f_bench_schema [iterations]", FCVAR_LINKED_CONCOMMAND | FCVAR_SPONLY)
+{
+	int iIterations = args.ArgC() < 2 ? 1000000 : V_StringToInt32(args[1], 1000000);
+
+	if (iIterations < 1)
+		iIterations = 1;
+
+	// Rebuild the old layout, a tree of classes each holding a tree of their fields, from the flat table
+	using MemberMap_t = CUtlMap<uint32_t, SchemaKey>;
+	CUtlMap<uint32_t, MemberMap_t *> oldMaps(0, 0, DefLessFunc(uint32_t));
+
+	CUtlVector<uint64_t> vecKeys;
+	schema::GetLoadedFields(vecKeys);
+
+	FOR_EACH_VEC(vecKeys, i)
+	{
+		uint64_t key = vecKeys[i];
+		auto classIndex = oldMaps.Find(key >> 32);
+
+		if (!oldMaps.IsValidIndex(classIndex))
+			classIndex = oldMaps.Insert(key >> 32, new MemberMap_t(0, 0, DefLessFunc(uint32_t)));
+
+		oldMaps[classIndex]->Insert((uint32_t)key, *schema::FindLoadedField(key));
+	}
+
+	static constexpr uint64_t hotKeys[] = {
+		((uint64_t)hash_32_fnv1a_const("CBaseEntity") << 32) | hash_32_fnv1a_const("m_iHealth"),
+		((uint64_t)hash_32_fnv1a_const("CBaseEntity") << 32) | hash_32_fnv1a_const("m_iTeamNum"),
+		((uint64_t)hash_32_fnv1a_const("CBasePlayerPawn") << 32) | hash_32_fnv1a_const("m_pMovementServices"),
+	};
+
+	int64 iSum = 0;
+	double flStart = Plat_FloatTime();
+
+	for (int i = 0; i < iIterations; i++)
+	{
+		uint64_t key = hotKeys[i % 3];
+		auto classIndex = oldMaps.Find(key >> 32);
+
+		if (oldMaps.IsValidIndex(classIndex))
+		{
+			auto memberIndex = oldMaps[classIndex]->Find((uint32_t)key);
+
+			if (oldMaps[classIndex]->IsValidIndex(memberIndex))
+				iSum += oldMaps[classIndex]->Element(memberIndex).offset;
+		}
+	}
+
+	double flOldLookupTime = Plat_FloatTime() - flStart;
+	flStart = Plat_FloatTime();
+
+	for (int i = 0; i < iIterations; i++)
+	{
+		const SchemaKey *pKey = schema::FindLoadedField(hotKeys[i % 3]);
+
+		if (pKey)
+			iSum += pKey->offset;
+	}
+
+	double flNewLookupTime = Plat_FloatTime() - flStart;
+
+	// Accessors read from a zeroed stand-in entity, big enough for any offset these fields have
+	const size_t nBufferSize = 1 << 16;
+	byte *pBuffer = new byte[nBufferSize]();
+	CBasePlayerPawn *pPawn = (CBasePlayerPawn *)pBuffer;
+
+	auto OldHealth = BENCH_OLD_ACCESSOR(int, CBaseEntity, m_iHealth);
+	auto OldTeamNum = BENCH_OLD_ACCESSOR(int, CBaseEntity, m_iTeamNum);
+	auto OldMovementServices = BENCH_OLD_ACCESSOR(CPlayer_MovementServices *, CBasePlayerPawn, m_pMovementServices);
+
+	flStart = Plat_FloatTime();
+
+	for (int i = 0; i < iIterations; i++)
+		iSum += OldHealth(pBuffer) + OldTeamNum(pBuffer) + (OldMovementServices(pBuffer) != nullptr);
+
+	double flOldAccessorTime = Plat_FloatTime() - flStart;
+	flStart = Plat_FloatTime();
+
+	for (int i = 0; i < iIterations; i++)
+		iSum += pPawn->m_iHealth() + pPawn->m_iTeamNum() + (pPawn->m_pMovementServices() != nullptr);
+
+	double flNewAccessorTime = Plat_FloatTime() - flStart;
+
+	delete[] pBuffer;
+	oldMaps.PurgeAndDeleteElements();
+
+	Message("cs2f_bench_schema: %d iterations, %d fields (checksum %lld)\n", iIterations, vecKeys.Count(), iSum);
+	Message("  lookup, CUtlMap of CUtlMap: %.2f ns\n", flOldLookupTime * 1000000000.0 / iIterations);
+	Message("  lookup, flat table:         %.2f ns\n", flNewLookupTime * 1000000000.0 / iIterations);
+	Message("  3 accessors, static key:    %.2f ns\n", flOldAccessorTime * 1000000000.0 / iIterations);
+	Message("  3 accessors, registration:  %.2f ns\n", flNewAccessorTime * 1000000000.0 / iIterations);
 }
 
 void CS2Fixes::AllPluginsLoaded()
@@ -652,6 +971,82 @@ CON_COMMAND_F(cs2f_fullupdate, "Force a full update for all clients.", FCVAR_LIN
 	FullUpdateAllClients();
 }
 
+CON_COMMAND_F(cs2f_timer_stats, "Print how many timers are live, how much memory the timer pool uses and deferred call queue usage.", FCVAR_LINKED_CONCOMMAND | FCVAR_SPONLY)
+{
+	TimerPoolStats_t stats = GetTimerPoolStats();
+
+	Message("Timers: %i live, %i peak, %i slabs, %llu bytes (%llu bytes per timer)\n",
+		stats.m_iLive, stats.m_iPeak, stats.m_iSlabs, (uint64)stats.m_nBytes, (uint64)sizeof(CTimer));
+
+	DeferredQueueStats_t deferred = GetDeferredQueueStats();
+
+	Message("Deferred calls: %i queued, %i high-water mark, %i capacity, %i overflows\n",
+		deferred.m_iQueued, deferred.m_iHighWater, deferred.m_iCapacity, deferred.m_iOverflows);
+
+	Message("Tasks: %i live\n", GetLiveTaskCount());
+}
+
+static bool g_bDumpTimersToFile = false;
+
+FAKE_BOOL_CVAR(cs2f_timers_dump_file, "Whether to append per call site timer usage to data/timers.log every minute", g_bDumpTimersToFile, false, false)
+
+// Every call site that created a timer, most expensive first
+static void DumpTimers(FILE *pFile)
+{
+	CUtlVector<TimerStats_t*> vecStats;
+	vecStats.AddVectorToTail(GetAllTimerStats());
+
+	vecStats.Sort([](TimerStats_t *const *a, TimerStats_t *const *b) -> int
+	{
+		if ((*a)->m_flTotalTime == (*b)->m_flTotalTime)
+			return 0;
+
+		return (*a)->m_flTotalTime < (*b)->m_flTotalTime ? 1 : -1;
+	});
+
+	char szLine[256];
+
+	FOR_EACH_VEC(vecStats, i)
+	{
+		TimerStats_t *pStats = vecStats[i];
+
+		V_snprintf(szLine, sizeof(szLine), "%6i live %8i created %10lli runs %10.2fms total %8.3fms max  %s\n",
+			pStats->m_iLive, pStats->m_iCreated, pStats->m_iExecutions, pStats->m_flTotalTime * 1000.0, pStats->m_flMaxTime * 1000.0, pStats->m_szName);
+
+		if (pFile)
+			fputs(szLine, pFile);
+		else
+			Message("%s", szLine);
+	}
+}
+
+CON_COMMAND_F(cs2f_timers_dump, "Print live instances, executions and time spent for every place timers are created from", FCVAR_LINKED_CONCOMMAND | FCVAR_SPONLY)
+{
+	DumpTimers(nullptr);
+}
+
+static void DumpTimersToFile()
+{
+	if (!g_bDumpTimersToFile)
+		return;
+
+	char szPath[MAX_PATH];
+	V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), "/csgo/addons/cs2fixes/data/timers.log");
+
+	FILE *pFile = fopen(szPath, "a");
+
+	if (!pFile)
+		return;
+
+	char szTime[64];
+	time_t now = time(nullptr);
+	strftime(szTime, sizeof(szTime), "%Y-%m-%d %H:%M:%S", localtime(&now));
+
+	fprintf(pFile, "[%s]\n", szTime);
+	DumpTimers(pFile);
+	fclose(pFile);
+}
+
 void CS2Fixes::Hook_ClientActive( CPlayerSlot slot, bool bLoadGame, const char *pszName, uint64 xuid )
 {
 	Message( "Hook_ClientActive(%d, %d, \"%s\", %lli)\n", slot, bLoadGame, pszName, xuid );
@@ -659,6 +1054,8 @@ void CS2Fixes::Hook_ClientActive( CPlayerSlot slot, bool bLoadGame, const char *
 
 void CS2Fixes::Hook_ClientCommand( CPlayerSlot slot, const CCommand &args )
 {
+	FRAME_PROBE("CS2Fixes::Hook_ClientCommand");
+
 #ifdef _DEBUG
 	Message( "Hook_ClientCommand(%d, \"%s\")\n", slot, args.GetCommandString() );
 #endif
@@ -709,6 +1106,8 @@ void CS2Fixes::Hook_OnClientConnected(CPlayerSlot slot, const char* pszName, uin
 
 bool CS2Fixes::Hook_ClientConnect( CPlayerSlot slot, const char *pszName, uint64 xuid, const char *pszNetworkID, bool unk1, CBufferString *pRejectReason )
 {
+	FRAME_PROBE("CS2Fixes::Hook_ClientConnect");
+
 	Message( "Hook_ClientConnect(%d, \"%s\", %lli, \"%s\", %d, \"%s\")\n", slot, pszName, xuid, pszNetworkID, unk1, pRejectReason->ToGrowable()->Get() );
 
 	// Player is banned
@@ -720,6 +1119,8 @@ bool CS2Fixes::Hook_ClientConnect( CPlayerSlot slot, const char *pszName, uint64
 
 void CS2Fixes::Hook_ClientPutInServer( CPlayerSlot slot, char const *pszName, int type, uint64 xuid )
 {
+	FRAME_PROBE("CS2Fixes::Hook_ClientPutInServer");
+
 	Message( "Hook_ClientPutInServer(%d, \"%s\", %d, %d, %lli)\n", slot, pszName, type, xuid );
 
 	if (!g_playerManager->GetPlayer(slot))
@@ -733,6 +1134,8 @@ void CS2Fixes::Hook_ClientPutInServer( CPlayerSlot slot, char const *pszName, in
 
 void CS2Fixes::Hook_ClientDisconnect( CPlayerSlot slot, ENetworkDisconnectionReason reason, const char *pszName, uint64 xuid, const char *pszNetworkID )
 {
+	FRAME_PROBE("CS2Fixes::Hook_ClientDisconnect");
+
 	Message( "Hook_ClientDisconnect(%d, %d, \"%s\", %lli)\n", slot, reason, pszName, xuid );
 	ZEPlayer* pPlayer = g_playerManager->GetPlayer(slot);
 
@@ -752,7 +1155,10 @@ void CS2Fixes::Hook_GameFramePost(bool simulating, bool bFirstTick, bool bLastTi
 	 * false | game is not ticking
 	 */
 
+	FrameBudget_OnGameFrame(simulating, gpGlobals->tickcount);
+
 	VPROF_BUDGET("CS2Fixes::Hook_GameFramePost", "CS2FixesPerFrame");
+	FRAME_PROBE("CS2Fixes::Hook_GameFramePost");
 
 	if (simulating && g_bHasTicked)
 	{
@@ -762,30 +1168,10 @@ void CS2Fixes::Hook_GameFramePost(bool simulating, bool bFirstTick, bool bLastTi
 	g_flLastTickedTime = gpGlobals->curtime;
 	g_bHasTicked = true;
 
-	for (int i = g_timers.Tail(); i != g_timers.InvalidIndex();)
-	{
-		auto timer = g_timers[i];
-
-		int prevIndex = i;
-		i = g_timers.Previous(i);
-
-		if (timer->m_flLastExecute == -1)
-			timer->m_flLastExecute = g_flUniversalTime;
-
-		// Timer execute 
-		if (timer->m_flLastExecute + timer->m_flInterval <= g_flUniversalTime)
-		{
-			if ((!timer->m_bPreserveRoundChange && timer->m_iRoundNum != g_iRoundNum) || !timer->Execute())
-			{
-				delete timer;
-				g_timers.Remove(prevIndex);
-			}
-			else
-			{
-				timer->m_flLastExecute = g_flUniversalTime;
-			}
-		}
-	}
+	RunDeferred();
+	RunTimers();
+	g_pJobScheduler->RunFrame();
+	g_playerManager->CheckHideDistances();
 
 	if (g_bEnableZR)
 		CZRRegenTimer::Tick();
@@ -802,6 +1188,11 @@ void CS2Fixes::Hook_CheckTransmit(CCheckTransmitInfo **ppInfoList, int infoCount
 		return;
 
 	VPROF("CS2Fixes::Hook_CheckTransmit");
+	FRAME_PROBE("CS2Fixes::Hook_CheckTransmit");
+
+	static TransmitPlayers_t players;
+	Transmit_BuildPlayers(players);
+	Transmit_BuildLOD();
 
 	for (int i = 0; i < infoCount; i++)
 	{
@@ -812,50 +1203,16 @@ void CS2Fixes::Hook_CheckTransmit(CCheckTransmitInfo **ppInfoList, int infoCount
 		static int offset = g_GameConfig->GetOffset("CheckTransmitPlayerSlot");
 		int iPlayerSlot = (int)*((uint8 *)pInfo + offset);
 
-		CCSPlayerController* pSelfController = CCSPlayerController::FromSlot(iPlayerSlot);
-
-		if (!pSelfController || !pSelfController->IsConnected())
+		if (!g_pPlayerSnapshot->IsValid(iPlayerSlot) || !g_pPlayerSnapshot->m_bConnected[iPlayerSlot])
 			continue;
 
-		auto pSelfZEPlayer = g_playerManager->GetPlayer(iPlayerSlot);
+		auto pSelfZEPlayer = g_pPlayerSnapshot->m_pZEPlayer[iPlayerSlot];
 
 		if (!pSelfZEPlayer)
 			continue;
 
-		for (int j = 0; j < gpGlobals->maxClients; j++)
-		{
-			CCSPlayerController* pController = CCSPlayerController::FromSlot(j);
-
-			// Always transmit to themselves
-			if (!pController || pController->m_bIsHLTV || j == iPlayerSlot)
-				continue;
-
-			// Don't transmit other players' flashlights, except the one they're watching if in spec
-			CBarnLight *pFlashLight = pController->IsConnected() ? g_playerManager->GetPlayer(j)->GetFlashLight() : nullptr;
-
-			if (!g_bFlashLightTransmitOthers && pFlashLight &&
-				!(pSelfController->GetPawnState() == STATE_OBSERVER_MODE && pSelfController->GetObserverTarget() == pController->GetPawn()))
-			{
-				pInfo->m_pTransmitEntity->Clear(pFlashLight->entindex());
-			}
-
-			// Always transmit other players if spectating
-			if (!g_bEnableHide || pSelfController->GetPawnState() == STATE_OBSERVER_MODE)
-				continue;
-
-			// Get the actual pawn as the player could be currently spectating
-			CCSPlayerPawn *pPawn = pController->GetPlayerPawn();
-
-			if (!pPawn)
-				continue;
-
-			// Hide players marked as hidden or ANY dead player, it seems that a ragdoll of a previously hidden player can crash?
-			// TODO: Revert this if/when valve fixes the issue?
-			// Also do not hide leaders to other players
-			ZEPlayer *pOtherZEPlayer = g_playerManager->GetPlayer(j);
-			if ((pSelfZEPlayer->ShouldBlockTransmit(j) && (pOtherZEPlayer && !pOtherZEPlayer->IsLeader())) || !pPawn->IsAlive())
-				pInfo->m_pTransmitEntity->Clear(pPawn->entindex());
-		}
+		Transmit_HidePlayers(players, iPlayerSlot, *pInfo->m_pTransmitEntity, !g_bFlashLightTransmitOthers, g_bEnableHide);
+		Transmit_CullDistant(iPlayerSlot, *pInfo->m_pTransmitEntity);
 
 		// Don't transmit glow model to it's owner
 		CBaseModelEntity *pGlowModel = pSelfZEPlayer->GetGlowModel();
@@ -898,6 +1255,8 @@ FAKE_BOOL_CVAR(cs2f_drop_map_weapons, "Whether to force drop map-spawned weapons
 
 bool CS2Fixes::Hook_OnTakeDamage_Alive(CTakeDamageInfoContainer *pInfoContainer)
 {
+	FRAME_PROBE("CS2Fixes::Hook_OnTakeDamage_Alive");
+
 	CCSPlayerPawn *pPawn = META_IFACEPTR(CCSPlayerPawn);
 
 	if (g_bEnableZR && ZR_Hook_OnTakeDamage_Alive(pInfoContainer->pInfo, pPawn))
@@ -913,6 +1272,8 @@ bool CS2Fixes::Hook_OnTakeDamage_Alive(CTakeDamageInfoContainer *pInfoContainer)
 
 void CS2Fixes::Hook_CheckMovingGround(double frametime)
 {
+	FRAME_PROBE("CS2Fixes::Hook_CheckMovingGround");
+
 	CCSPlayer_MovementServices *pMove = META_IFACEPTR(CCSPlayer_MovementServices);
 	CCSPlayerPawn *pPawn = pMove->GetPawn();
 	CCSPlayerController *pController = pPawn->GetOriginalController();
@@ -959,7 +1320,6 @@ void CS2Fixes::OnLevelInit( char const *pMapName,
 	V_snprintf(cmd, sizeof(cmd), "exec cs2fixes/maps/%s", pMapName);
 	g_pEngineServer2->ServerCommand(cmd);
 
-	g_playerManager->SetupInfiniteAmmo();
 	g_pMapVoteSystem->OnLevelInit(pMapName);
 
 	if (g_bEnableZR)
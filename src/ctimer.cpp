@@ -18,25 +18,526 @@
  */
 
 #include "ctimer.h"
+#include "framebudget.h"
+#include "tier0/platform.h"
+#include "utlmap.h"
+#include "strtools.h"
+#include <memory>
 
-CUtlLinkedList<CTimerBase*> g_timers;
+extern double g_flUniversalTime;
+
+struct TimerSlot_t
+{
+    CTimer *m_pTimer;
+    uint32 m_iSerial;
+};
+
+// Handles point into this table, a slot's serial is bumped every time it's released so stale handles never match
+static CUtlVector<TimerSlot_t> g_timerSlots;
+static CUtlVector<int> g_freeTimerSlots;
+
+// First timer of every owner's list, the rest is linked through the timers themselves
+static CUtlMap<uint64, CTimer*> g_ownedTimers(DefLessFunc(uint64));
+
+// Timers are carved out of fixed size slabs and recycled through a free list, so creating one in steady state never hits the heap
+static constexpr int TIMERS_PER_SLAB = 64;
+
+union TimerPoolSlot_t
+{
+    TimerPoolSlot_t *m_pNextFree;
+    alignas(CTimer) unsigned char m_data[sizeof(CTimer)];
+};
+
+static CUtlVector<TimerPoolSlot_t*> g_timerSlabs;
+static TimerPoolSlot_t *g_pFreeTimerSlot = nullptr;
+static int g_iLiveTimers = 0;
+static int g_iPeakTimers = 0;
+
+void *CTimer::operator new(size_t nSize)
+{
+    // Should a derived class ever show up it just gets a regular allocation
+    if (nSize != sizeof(CTimer))
+        return ::operator new(nSize);
+
+    if (!g_pFreeTimerSlot)
+    {
+        TimerPoolSlot_t *pSlab = (TimerPoolSlot_t*)::operator new(sizeof(TimerPoolSlot_t) * TIMERS_PER_SLAB);
+        g_timerSlabs.AddToTail(pSlab);
+
+        for (int i = 0; i < TIMERS_PER_SLAB; i++)
+            pSlab[i].m_pNextFree = i + 1 < TIMERS_PER_SLAB ? &pSlab[i + 1] : nullptr;
+
+        g_pFreeTimerSlot = pSlab;
+    }
+
+    TimerPoolSlot_t *pSlot = g_pFreeTimerSlot;
+    g_pFreeTimerSlot = pSlot->m_pNextFree;
+
+    if (++g_iLiveTimers > g_iPeakTimers)
+        g_iPeakTimers = g_iLiveTimers;
+
+    return pSlot;
+}
+
+void CTimer::operator delete(void *pMem, size_t nSize)
+{
+    if (nSize != sizeof(CTimer))
+    {
+        ::operator delete(pMem);
+        return;
+    }
+
+    TimerPoolSlot_t *pSlot = (TimerPoolSlot_t*)pMem;
+    pSlot->m_pNextFree = g_pFreeTimerSlot;
+    g_pFreeTimerSlot = pSlot;
+
+    g_iLiveTimers--;
+}
+
+TimerPoolStats_t GetTimerPoolStats()
+{
+    return { g_iLiveTimers, g_iPeakTimers, g_timerSlabs.Count(), (size_t)g_timerSlabs.Count() * TIMERS_PER_SLAB * sizeof(TimerPoolSlot_t) };
+}
+
+struct TimerHeapEntry_t
+{
+    double m_flNextExecute;
+    CTimer *m_pTimer;
+};
+
+// Binary min-heap keyed on the next execution time, so a frame only has to look at the timers that are actually due
+static CUtlVector<TimerHeapEntry_t> g_timerHeap;
+
+// Timers created since the last frame, their interval starts counting from the frame they are first seen in
+static CUtlVector<CTimer*> g_newTimers;
+
+static void SiftUp(int i)
+{
+    TimerHeapEntry_t entry = g_timerHeap[i];
+
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+
+        if (g_timerHeap[parent].m_flNextExecute <= entry.m_flNextExecute)
+            break;
+
+        g_timerHeap[i] = g_timerHeap[parent];
+        i = parent;
+    }
+
+    g_timerHeap[i] = entry;
+}
+
+static void SiftDown(int i)
+{
+    int count = g_timerHeap.Count();
+    TimerHeapEntry_t entry = g_timerHeap[i];
+
+    while (true)
+    {
+        int child = i * 2 + 1;
+
+        if (child >= count)
+            break;
+
+        if (child + 1 < count && g_timerHeap[child + 1].m_flNextExecute < g_timerHeap[child].m_flNextExecute)
+            child++;
+
+        if (entry.m_flNextExecute <= g_timerHeap[child].m_flNextExecute)
+            break;
+
+        g_timerHeap[i] = g_timerHeap[child];
+        i = child;
+    }
+
+    g_timerHeap[i] = entry;
+}
+
+static void PushTimer(CTimer *pTimer, double flNextExecute)
+{
+    int i = g_timerHeap.AddToTail({flNextExecute, pTimer});
+    SiftUp(i);
+}
+
+static CTimer *PopTimer()
+{
+    CTimer *pTimer = g_timerHeap[0].m_pTimer;
+    int last = g_timerHeap.Count() - 1;
+
+    g_timerHeap[0] = g_timerHeap[last];
+    g_timerHeap.Remove(last);
+
+    if (g_timerHeap.Count())
+        SiftDown(0);
+
+    return pTimer;
+}
+
+static void UnlinkOwner(CTimer *pTimer)
+{
+    if (!pTimer->m_owner.IsValid())
+        return;
+
+    if (pTimer->m_pNextOwned)
+        pTimer->m_pNextOwned->m_pPrevOwned = pTimer->m_pPrevOwned;
+
+    if (pTimer->m_pPrevOwned)
+    {
+        pTimer->m_pPrevOwned->m_pNextOwned = pTimer->m_pNextOwned;
+    }
+    else
+    {
+        int index = g_ownedTimers.Find(pTimer->m_owner.m_nKey);
+
+        if (pTimer->m_pNextOwned)
+            g_ownedTimers[index] = pTimer->m_pNextOwned;
+        else
+            g_ownedTimers.RemoveAt(index);
+    }
+
+    pTimer->m_owner = TimerOwner_t();
+    pTimer->m_pPrevOwned = nullptr;
+    pTimer->m_pNextOwned = nullptr;
+}
+
+static void ReleaseHandle(CTimer *pTimer)
+{
+    int iIndex = pTimer->m_hHandle.m_iIndex;
+
+    if (iIndex < 0)
+        return;
+
+    g_timerSlots[iIndex].m_pTimer = nullptr;
+    g_timerSlots[iIndex].m_iSerial++;
+    g_freeTimerSlots.AddToTail(iIndex);
+
+    pTimer->m_hHandle = CTimerHandle();
+}
+
+static CUtlVector<TimerStats_t*> g_timerStats;
+static CUtlMap<uint64, TimerStats_t*> g_timerStatsLookup(DefLessFunc(uint64));
+
+TimerStats_t *GetTimerStats(const std::source_location &location)
+{
+    // File name strings are unique per translation unit, so together with the line they identify a call site
+    uint64 nKey = ((uint64)(uintptr_t)location.file_name() * 31) ^ ((uint64)location.line() << 48) ^ location.column();
+
+    int index = g_timerStatsLookup.Find(nKey);
+
+    if (g_timerStatsLookup.IsValidIndex(index))
+        return g_timerStatsLookup[index];
+
+    TimerStats_t *pStats = new TimerStats_t();
+    V_snprintf(pStats->m_szName, sizeof(pStats->m_szName), "%s:%u %s", V_UnqualifiedFileName(location.file_name()), location.line(), location.function_name());
+
+    g_timerStats.AddToTail(pStats);
+    g_timerStatsLookup.Insert(nKey, pStats);
+
+    return pStats;
+}
+
+const CUtlVector<TimerStats_t*> &GetAllTimerStats()
+{
+    return g_timerStats;
+}
+
+void AddTimer(CTimer *pTimer, TimerOwner_t owner, const std::source_location &location)
+{
+    pTimer->m_pStats = GetTimerStats(location);
+    pTimer->m_pStats->m_iCreated++;
+    pTimer->m_pStats->m_iLive++;
+
+    int iIndex;
+
+    if (g_freeTimerSlots.Count())
+    {
+        iIndex = g_freeTimerSlots.Tail();
+        g_freeTimerSlots.RemoveMultipleFromTail(1);
+    }
+    else
+    {
+        iIndex = g_timerSlots.AddToTail({nullptr, 1});
+    }
+
+    g_timerSlots[iIndex].m_pTimer = pTimer;
+    pTimer->m_hHandle = CTimerHandle(iIndex, g_timerSlots[iIndex].m_iSerial);
+
+    if (owner.IsValid())
+    {
+        pTimer->m_owner = owner;
+
+        int index = g_ownedTimers.Find(owner.m_nKey);
+
+        if (g_ownedTimers.IsValidIndex(index))
+        {
+            pTimer->m_pNextOwned = g_ownedTimers[index];
+            pTimer->m_pNextOwned->m_pPrevOwned = pTimer;
+            g_ownedTimers[index] = pTimer;
+        }
+        else
+        {
+            g_ownedTimers.Insert(owner.m_nKey, pTimer);
+        }
+    }
+
+    g_newTimers.AddToTail(pTimer);
+}
+
+void ReleaseTimer(CTimer *pTimer)
+{
+    UnlinkOwner(pTimer);
+    ReleaseHandle(pTimer);
+}
+
+void CTimer::Cancel()
+{
+    // The timer stays queued until the timer system reaches it, it just never executes again
+    m_bCancelled = true;
+    ReleaseTimer(this);
+}
+
+CTimer *CTimerHandle::Get() const
+{
+    if (m_iIndex < 0 || m_iIndex >= g_timerSlots.Count() || g_timerSlots[m_iIndex].m_iSerial != m_iSerial)
+        return nullptr;
+
+    return g_timerSlots[m_iIndex].m_pTimer;
+}
+
+void CTimerHandle::Cancel()
+{
+    CTimer *pTimer = Get();
+
+    if (pTimer)
+        pTimer->Cancel();
+}
+
+void CancelTimers(TimerOwner_t owner)
+{
+    if (!owner.IsValid() || !g_ownedTimers.Count())
+        return;
+
+    int index = g_ownedTimers.Find(owner.m_nKey);
+
+    if (!g_ownedTimers.IsValidIndex(index))
+        return;
+
+    CTimer *pTimer = g_ownedTimers[index];
+    g_ownedTimers.RemoveAt(index);
+
+    while (pTimer)
+    {
+        CTimer *pNext = pTimer->m_pNextOwned;
+
+        // Already detached from the map above, so just clear the links instead of unlinking one by one
+        pTimer->m_owner = TimerOwner_t();
+        pTimer->m_pPrevOwned = nullptr;
+        pTimer->m_pNextOwned = nullptr;
+        pTimer->m_bCancelled = true;
+        ReleaseHandle(pTimer);
+
+        pTimer = pNext;
+    }
+}
+
+struct DeferredCall_t
+{
+    int m_iTicksLeft;
+    int m_iRoundNum;
+    CInlineFunc<void> m_func;
+};
+
+// Ring buffer of deferred calls, sized so a normal frame never comes close, anything beyond it spills over into a timer
+static constexpr int DEFERRED_QUEUE_SIZE = 1024;
+
+alignas(DeferredCall_t) static unsigned char g_deferredStorage[DEFERRED_QUEUE_SIZE][sizeof(DeferredCall_t)];
+static int g_iDeferredHead = 0;
+static int g_iDeferredCount = 0;
+static int g_iDeferredHighWater = 0;
+static int g_iDeferredOverflows = 0;
+
+static DeferredCall_t *GetDeferredSlot(int i)
+{
+    return (DeferredCall_t *)g_deferredStorage[i % DEFERRED_QUEUE_SIZE];
+}
+
+void QueueDeferred(CInlineFunc<void> &&func, int iTicks)
+{
+    if (g_iDeferredCount == DEFERRED_QUEUE_SIZE)
+    {
+        if (g_iDeferredOverflows++ == 0)
+            Warning("Deferred call queue is full, falling back to timers\n");
+
+        // The callback owns the function, so it's freed along with the timer even if that never gets to run
+        // A 0 interval timer runs once per frame just like the queue is drained, and it's dropped on round change the same way
+        new CTimer(0.0f, false, false, [pFunc = std::make_unique<CInlineFunc<void>>(std::move(func)), iTicks]() mutable
+        {
+            if (--iTicks > 0)
+                return 0.0f;
+
+            (*pFunc)();
+            return -1.0f;
+        });
+
+        return;
+    }
+
+    new (GetDeferredSlot(g_iDeferredHead + g_iDeferredCount)) DeferredCall_t{iTicks, g_iRoundNum, std::move(func)};
+
+    if (++g_iDeferredCount > g_iDeferredHighWater)
+        g_iDeferredHighWater = g_iDeferredCount;
+}
+
+void RunDeferred()
+{
+    // Only go through what's queued right now, anything queued by these callbacks waits for the next drain
+    for (int i = g_iDeferredCount; i > 0; i--)
+    {
+        DeferredCall_t *pCall = GetDeferredSlot(g_iDeferredHead);
+        g_iDeferredHead = (g_iDeferredHead + 1) % DEFERRED_QUEUE_SIZE;
+        g_iDeferredCount--;
+
+        // Move out of the ring first, the callback is free to queue more calls into the slot
+        int iTicksLeft = pCall->m_iTicksLeft - 1;
+        int iRoundNum = pCall->m_iRoundNum;
+        CInlineFunc<void> func(std::move(pCall->m_func));
+        pCall->~DeferredCall_t();
+
+        // Like a CTimer that doesn't preserve round change, calls queued in an earlier round are dropped
+        if (iRoundNum != g_iRoundNum)
+            continue;
+
+        if (iTicksLeft > 0)
+        {
+            // Not due yet, back to the end of the queue
+            new (GetDeferredSlot(g_iDeferredHead + g_iDeferredCount)) DeferredCall_t{iTicksLeft, iRoundNum, std::move(func)};
+            g_iDeferredCount++;
+            continue;
+        }
+
+        FRAME_PROBE("Deferred call");
+        func();
+    }
+}
+
+static void ClearDeferred()
+{
+    for (; g_iDeferredCount > 0; g_iDeferredCount--)
+    {
+        GetDeferredSlot(g_iDeferredHead)->~DeferredCall_t();
+        g_iDeferredHead = (g_iDeferredHead + 1) % DEFERRED_QUEUE_SIZE;
+    }
+}
+
+DeferredQueueStats_t GetDeferredQueueStats()
+{
+    return { g_iDeferredCount, DEFERRED_QUEUE_SIZE, g_iDeferredHighWater, g_iDeferredOverflows };
+}
+
+void RunTimers()
+{
+    FOR_EACH_VEC(g_newTimers, i)
+    {
+        CTimer *pTimer = g_newTimers[i];
+
+        if (pTimer->IsCancelled())
+        {
+            delete pTimer;
+            continue;
+        }
+
+        pTimer->m_flLastExecute = g_flUniversalTime;
+        PushTimer(pTimer, g_flUniversalTime + pTimer->m_flInterval);
+    }
+
+    g_newTimers.RemoveAll();
+
+    // Timers that keep running are only pushed back after the loop, otherwise a 0 interval would run forever in this frame
+    static CUtlVector<CTimer*> s_vecRescheduled;
+
+    while (g_timerHeap.Count() && g_timerHeap[0].m_flNextExecute <= g_flUniversalTime)
+    {
+        CTimer *pTimer = PopTimer();
+
+        if (pTimer->IsCancelled() || (!pTimer->m_bPreserveRoundChange && pTimer->m_iRoundNum != g_iRoundNum))
+        {
+            delete pTimer;
+            continue;
+        }
+
+        FRAME_PROBE(pTimer->m_pStats->m_szName);
+
+        double flStart = Plat_FloatTime();
+        bool bContinue = pTimer->Execute();
+        double flTime = Plat_FloatTime() - flStart;
+
+        TimerStats_t *pStats = pTimer->m_pStats;
+        pStats->m_iExecutions++;
+        pStats->m_flTotalTime += flTime;
+
+        if (flTime > pStats->m_flMaxTime)
+            pStats->m_flMaxTime = flTime;
+
+        if (!bContinue)
+        {
+            delete pTimer;
+            continue;
+        }
+
+        pTimer->m_flLastExecute = g_flUniversalTime;
+        s_vecRescheduled.AddToTail(pTimer);
+    }
+
+    FOR_EACH_VEC(s_vecRescheduled, i)
+    {
+        CTimer *pTimer = s_vecRescheduled[i];
+
+        // A timer callback may have cancelled another timer that already ran this frame
+        if (pTimer->IsCancelled())
+            delete pTimer;
+        else
+            PushTimer(pTimer, g_flUniversalTime + pTimer->m_flInterval);
+    }
+
+    s_vecRescheduled.RemoveAll();
+}
 
 void RemoveTimers()
 {
-	g_timers.PurgeAndDeleteElements();
+    ClearDeferred();
+
+    FOR_EACH_VEC(g_timerHeap, i)
+        delete g_timerHeap[i].m_pTimer;
+
+    g_timerHeap.Purge();
+    g_newTimers.PurgeAndDeleteElements();
 }
 
 void RemoveMapTimers()
 {
-    for (int i = g_timers.Tail(); i != g_timers.InvalidIndex();)
+    // Deferred calls only ever point a few ticks ahead, none of them should survive a map change
+    ClearDeferred();
+
+    for (int i = g_newTimers.Count() - 1; i >= 0; i--)
     {
-        int prevIndex = i;
-        i = g_timers.Previous(i);
+        if (g_newTimers[i]->m_bPreserveMapChange)
+            continue;
+
+        delete g_newTimers[i];
+        g_newTimers.Remove(i);
+    }
 
-        if(g_timers[prevIndex]->m_bPreserveMapChange)
+    for (int i = g_timerHeap.Count() - 1; i >= 0; i--)
+    {
+        if (g_timerHeap[i].m_pTimer->m_bPreserveMapChange)
             continue;
 
-        delete g_timers[prevIndex];
-        g_timers.Remove(prevIndex);
+        delete g_timerHeap[i].m_pTimer;
+        g_timerHeap.FastRemove(i);
     }
-}
\ No newline at end of file
+
+    // Restore the heap property over whatever is left
+    for (int i = g_timerHeap.Count() / 2 - 1; i >= 0; i--)
+        SiftDown(i);
+}
@@ -18,8 +18,12 @@
  */
 
 #pragma once
-#include <functional>
-#include "utllinkedlist.h"
+#include <cstddef>
+#include <new>
+#include <source_location>
+#include <type_traits>
+#include <utility>
+#include "utlvector.h"
 
 extern int g_iRoundNum;
 
@@ -31,6 +35,8 @@ public:
         m_iRoundNum = g_iRoundNum;
     }
 
+    virtual ~CTimerBase() {}
+
     virtual bool Execute() = 0;
 
     float m_flInterval;
@@ -40,19 +46,134 @@ public:
     int m_iRoundNum;
 };
 
-extern CUtlLinkedList<CTimerBase*> g_timers;
+class CTimer;
+
+// Tag used to cancel every timer belonging to a player or an entity at once
+struct TimerOwner_t
+{
+    uint64 m_nKey = 0;
+
+    static TimerOwner_t Player(int iSlot) { return { ((uint64)1 << 32) | (uint32)iSlot }; }
+    static TimerOwner_t Entity(uint32 iEntityHandle) { return { ((uint64)2 << 32) | iEntityHandle }; }
+
+    bool IsValid() const { return m_nKey != 0; }
+    bool operator==(const TimerOwner_t &other) const { return m_nKey == other.m_nKey; }
+};
+
+// Weak reference to a timer, stays safe to use after the timer has finished or was deleted
+class CTimerHandle
+{
+public:
+    CTimerHandle() : m_iIndex(-1), m_iSerial(0) {}
+    CTimerHandle(int iIndex, uint32 iSerial) : m_iIndex(iIndex), m_iSerial(iSerial) {}
+
+    bool IsValid() const { return Get() != nullptr; }
+    CTimer *Get() const;
+
+    // Stops the timer from ever running again, it will be freed the next time the timer system gets to it
+    void Cancel();
+
+    int m_iIndex;
+    uint32 m_iSerial;
+};
+
+// Usage numbers for every place timers get created from, see cs2f_timers_dump
+struct TimerStats_t
+{
+    char m_szName[128];
+    int m_iCreated;
+    int m_iLive;
+    int64 m_iExecutions;
+    double m_flTotalTime;
+    double m_flMaxTime;
+};
+
+TimerStats_t *GetTimerStats(const std::source_location &location);
+const CUtlVector<TimerStats_t*> &GetAllTimerStats();
+
+void AddTimer(CTimer *pTimer, TimerOwner_t owner, const std::source_location &location);
+void ReleaseTimer(CTimer *pTimer);
+
+// Fixed-capacity replacement for std::function, the callable is always stored inline so timers and deferred calls never allocate for it
+template <typename R>
+class CInlineFunc
+{
+public:
+    static constexpr size_t MAX_SIZE = 48;
+
+    template <typename F> requires (!std::is_same_v<std::decay_t<F>, CInlineFunc>)
+    CInlineFunc(F &&func)
+    {
+        using Func_t = std::decay_t<F>;
+
+        static_assert(sizeof(Func_t) <= MAX_SIZE, "Timer callback captures too much, capture handles instead of objects");
+        static_assert(alignof(Func_t) <= alignof(std::max_align_t), "Timer callback is over-aligned");
+
+        new (m_storage) Func_t(std::forward<F>(func));
+
+        m_pfnInvoke = [](void *pFunc) -> R { return (*(Func_t*)pFunc)(); };
+        m_pfnMove = [](void *pDest, void *pSrc) { new (pDest) Func_t(std::move(*(Func_t*)pSrc)); };
+        m_pfnDestroy = [](void *pFunc) { ((Func_t*)pFunc)->~Func_t(); };
+    }
+
+    CInlineFunc(CInlineFunc &&other) :
+        m_pfnInvoke(other.m_pfnInvoke), m_pfnMove(other.m_pfnMove), m_pfnDestroy(other.m_pfnDestroy)
+    {
+        m_pfnMove(m_storage, other.m_storage);
+    }
+
+    ~CInlineFunc()
+    {
+        m_pfnDestroy(m_storage);
+    }
+
+    CInlineFunc(const CInlineFunc &) = delete;
+    CInlineFunc &operator=(const CInlineFunc &) = delete;
+
+    R operator()() { return m_pfnInvoke(m_storage); }
+
+private:
+    alignas(std::max_align_t) unsigned char m_storage[MAX_SIZE];
+    R (*m_pfnInvoke)(void *);
+    void (*m_pfnMove)(void *, void *);
+    void (*m_pfnDestroy)(void *);
+};
+
+typedef CInlineFunc<float> CTimerFunc;
 
 // Timer functions should return the time until next execution, or a negative value like -1.0f to stop
 // Having an interval of 0 is fine, in this case it will run on every game frame
 class CTimer : public CTimerBase
 {
 public:
-    CTimer(float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange, std::function<float()> func) :
-		CTimerBase(flInitialInterval, bPreserveMapChange, bPreserveRoundChange), m_func(func)
+    // Timers are named after the place they're created from, leave location alone unless forwarding it from a wrapper
+    template <typename F>
+    CTimer(float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange, F &&func,
+        const std::source_location &location = std::source_location::current()) :
+		CTimerBase(flInitialInterval, bPreserveMapChange, bPreserveRoundChange), m_func(std::forward<F>(func))
     {
-        g_timers.AddToTail(this);
+        AddTimer(this, TimerOwner_t(), location);
     };
 
+    // Owned timers get cancelled along with their owner, see CancelTimers
+    template <typename F>
+    CTimer(float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange, TimerOwner_t owner, F &&func,
+        const std::source_location &location = std::source_location::current()) :
+		CTimerBase(flInitialInterval, bPreserveMapChange, bPreserveRoundChange), m_func(std::forward<F>(func))
+    {
+        AddTimer(this, owner, location);
+    };
+
+    ~CTimer()
+    {
+        ReleaseTimer(this);
+        m_pStats->m_iLive--;
+    }
+
+    // Timers come out of a pool, see ctimer.cpp
+    static void *operator new(size_t nSize);
+    static void operator delete(void *pMem, size_t nSize);
+
     inline bool Execute() override
     {
 	    m_flInterval = m_func();
@@ -60,9 +181,63 @@ public:
         return m_flInterval >= 0;
 	}
 
-    std::function<float()> m_func;
+    CTimerHandle GetHandle() { return m_hHandle; }
+    bool IsCancelled() { return m_bCancelled; }
+    void Cancel();
+
+    CTimerFunc m_func;
+    TimerStats_t *m_pStats;
+    CTimerHandle m_hHandle;
+    bool m_bCancelled = false;
+
+    // Intrusive list of the timers sharing the same owner
+    TimerOwner_t m_owner;
+    CTimer *m_pPrevOwned = nullptr;
+    CTimer *m_pNextOwned = nullptr;
+};
+
+// Cancels every timer tagged with this owner
+void CancelTimers(TimerOwner_t owner);
+
+struct TimerPoolStats_t
+{
+    int m_iLive;
+    int m_iPeak;
+    int m_iSlabs;
+    size_t m_nBytes;
+};
+
+TimerPoolStats_t GetTimerPoolStats();
+
+// Runs a callback at the next deferred drain (in GameFramePost, before timers) or iTicks drains from now,
+// this is much cheaper than a CTimer with a 0 interval as it goes through a fixed size ring buffer
+// Like such a timer, calls still queued when the round changes are dropped
+void QueueDeferred(CInlineFunc<void> &&func, int iTicks);
+
+template <typename F>
+void RunNextTick(F &&func)
+{
+    QueueDeferred(CInlineFunc<void>(std::forward<F>(func)), 1);
+}
+
+template <typename F>
+void RunInTicks(int iTicks, F &&func)
+{
+    QueueDeferred(CInlineFunc<void>(std::forward<F>(func)), iTicks);
+}
+
+struct DeferredQueueStats_t
+{
+    int m_iQueued;
+    int m_iCapacity;
+    int m_iHighWater;
+    int m_iOverflows;
 };
 
+void RunDeferred();
+DeferredQueueStats_t GetDeferredQueueStats();
 
+// Runs every timer that is due, called once per game frame
+void RunTimers();
 void RemoveTimers();
-void RemoveMapTimers();
\ No newline at end of file
+void RemoveMapTimers();
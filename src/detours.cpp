@@ -28,6 +28,7 @@
 #include "commands.h"
 #include "detours.h"
 #include "ctimer.h"
+#include "framebudget.h"
 #include "irecipientfilter.h"
 #include "entity/ccsplayercontroller.h"
 #include "entity/ccsplayerpawn.h"
@@ -83,6 +84,8 @@ FAKE_BOOL_CVAR(cs2f_block_all_dmg, "Whether to block all damage to players", g_b
 
 void FASTCALL Detour_CBaseEntity_TakeDamageOld(CBaseEntity *pThis, CTakeDamageInfo *inputInfo)
 {
+	FRAME_PROBE("Detour_CBaseEntity_TakeDamageOld");
+
 #ifdef _DEBUG
 	Message("\n--------------------------------\n"
 			"TakeDamage on %s\n"
@@ -126,6 +129,8 @@ FAKE_BOOL_CVAR(cs2f_log_pushes, "Whether to log pushes (cs2f_use_old_push must b
 
 void FASTCALL Detour_TriggerPush_Touch(CTriggerPush* pPush, CBaseEntity* pOther)
 {
+	FRAME_PROBE("Detour_TriggerPush_Touch");
+
 	// This trigger pushes only once (and kills itself) or pushes only on StartTouch, both of which are fine already
 	if (!g_bUseOldPush || pPush->m_spawnflags() & SF_TRIG_PUSH_ONCE || pPush->m_bTriggerOnStartTouch())
 	{
@@ -202,6 +207,8 @@ void FASTCALL Detour_TriggerPush_Touch(CTriggerPush* pPush, CBaseEntity* pOther)
 
 bool FASTCALL Detour_IsHearingClient(void* serverClient, int index)
 {
+	FRAME_PROBE_HOT("Detour_IsHearingClient");
+
 	ZEPlayer* player = g_playerManager->GetPlayer(index);
 	if (player && player->IsMuted())
 		return false;
@@ -309,6 +316,8 @@ FAKE_BOOL_CVAR(cs2f_trigger_timer_enable, "Whether to process countdown messages
 
 void FASTCALL Detour_UTIL_SayTextFilter(IRecipientFilter &filter, const char *pText, CCSPlayerController *pPlayer, uint64 eMessageType)
 {
+	FRAME_PROBE("Detour_UTIL_SayTextFilter");
+
 	if (pPlayer)
 		return UTIL_SayTextFilter(filter, pText, pPlayer, eMessageType);
 
@@ -331,6 +340,8 @@ void FASTCALL Detour_UTIL_SayText2Filter(
 	const char *param3,
 	const char *param4)
 {
+	FRAME_PROBE("Detour_UTIL_SayText2Filter");
+
 #ifdef _DEBUG
     CPlayerSlot slot = filter.GetRecipientIndex(0);
 	CCSPlayerController* target = CCSPlayerController::FromSlot(slot);
@@ -344,6 +355,8 @@ void FASTCALL Detour_UTIL_SayText2Filter(
 
 bool FASTCALL Detour_CCSPlayer_WeaponServices_CanUse(CCSPlayer_WeaponServices *pWeaponServices, CBasePlayerWeapon* pPlayerWeapon)
 {
+	FRAME_PROBE("Detour_CCSPlayer_WeaponServices_CanUse");
+
 	if (g_bEnableZR && !ZR_Detour_CCSPlayer_WeaponServices_CanUse(pWeaponServices, pPlayerWeapon))
 	{
 		return false;
@@ -354,6 +367,8 @@ bool FASTCALL Detour_CCSPlayer_WeaponServices_CanUse(CCSPlayer_WeaponServices *p
 
 bool FASTCALL Detour_CEntityIdentity_AcceptInput(CEntityIdentity* pThis, CUtlSymbolLarge* pInputName, CEntityInstance* pActivator, CEntityInstance* pCaller, variant_t* value, int nOutputID)
 {
+	FRAME_PROBE("Detour_CEntityIdentity_AcceptInput");
+
 	VPROF_SCOPE_BEGIN("Detour_CEntityIdentity_AcceptInput");
 
 	if (g_bEnableZR)
@@ -431,6 +446,8 @@ FAKE_BOOL_CVAR(cs2f_block_nav_lookup, "Whether to block navigation mesh lookup,
 
 void* FASTCALL Detour_CNavMesh_GetNearestNavArea(int64_t unk1, float* unk2, unsigned int* unk3, unsigned int unk4, int64_t unk5, int64_t unk6, float unk7, int64_t unk8)
 {
+	FRAME_PROBE("Detour_CNavMesh_GetNearestNavArea");
+
 	if (g_bBlockNavLookup)
 		return nullptr;
 
@@ -439,6 +456,8 @@ void* FASTCALL Detour_CNavMesh_GetNearestNavArea(int64_t unk1, float* unk2, unsi
 
 void FASTCALL Detour_ProcessMovement(CCSPlayer_MovementServices *pThis, void *pMove)
 {
+	FRAME_PROBE_HOT("Detour_ProcessMovement");
+
 	CCSPlayerPawn *pPawn = pThis->GetPawn();
 
 	if (!pPawn->IsAlive())
@@ -482,6 +501,8 @@ public:
 
 void* FASTCALL Detour_ProcessUsercmds(CCSPlayerController *pController, CUserCmd *cmds, int numcmds, bool paused, float margin)
 {
+	FRAME_PROBE_HOT("Detour_ProcessUsercmds");
+
 	// Push fix only works properly if subtick movement is also disabled
 	if (!g_bDisableSubtick && !g_bUseOldPush)
 		return ProcessUsercmds(pController, cmds, numcmds, paused, margin);
@@ -498,17 +519,23 @@ void* FASTCALL Detour_ProcessUsercmds(CCSPlayerController *pController, CUserCmd
 
 void FASTCALL Detour_CGamePlayerEquip_InputTriggerForAllPlayers(CGamePlayerEquip* pEntity, InputData_t* pInput)
 {
+	FRAME_PROBE("Detour_CGamePlayerEquip_InputTriggerForAllPlayers");
+
     CGamePlayerEquipHandler::TriggerForAllPlayers(pEntity, pInput);
     CGamePlayerEquip_InputTriggerForAllPlayers(pEntity, pInput);
 }
 void FASTCALL Detour_CGamePlayerEquip_InputTriggerForActivatedPlayer(CGamePlayerEquip* pEntity, InputData_t* pInput)
 {
+	FRAME_PROBE("Detour_CGamePlayerEquip_InputTriggerForActivatedPlayer");
+
 	if (CGamePlayerEquipHandler::TriggerForActivatedPlayer(pEntity, pInput))
 		CGamePlayerEquip_InputTriggerForActivatedPlayer(pEntity, pInput);
 }
 
 CServerSideClient* FASTCALL Detour_GetFreeClient(int64_t unk1, const __m128i* unk2, unsigned int unk3, int64_t unk4, char unk5, void* unk6)
 {
+	FRAME_PROBE("Detour_GetFreeClient");
+
 	// Check if there is still unused slots, this should never break so just fall back to original behaviour for ease (we don't have a CServerSideClient constructor)
 	if (gpGlobals->maxClients != GetClientList()->Count())
 		return GetFreeClient(unk1, unk2, unk3, unk4, unk5, unk6);
@@ -528,6 +555,8 @@ CServerSideClient* FASTCALL Detour_GetFreeClient(int64_t unk1, const __m128i* un
 
 float FASTCALL Detour_CCSPlayerPawn_GetMaxSpeed(CCSPlayerPawn* pPawn)
 {
+	FRAME_PROBE_HOT("Detour_CCSPlayerPawn_GetMaxSpeed");
+
 	auto flMaxSpeed = CCSPlayerPawn_GetMaxSpeed(pPawn);
 
 	const auto pController = reinterpret_cast<CCSPlayerController*>(pPawn->GetController());
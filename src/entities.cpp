@@ -54,11 +54,9 @@ inline void DelayInput(CBaseEntity* pCaller, const char* input, const char* para
 {
     const auto eh = pCaller->GetHandle();
 
-    new CTimer(0.f, false, false, [eh, input, param]() {
+    RunNextTick([eh, input, param]() {
         if (const auto entity = reinterpret_cast<CBaseEntity*>(eh.Get()))
             entity->AcceptInput(input, param, nullptr, entity);
-
-        return -1.f;
     });
 }
 
@@ -68,12 +66,10 @@ inline void DelayInput(CBaseEntity* pCaller, CBaseEntity* pActivator, const char
     const auto eh = pCaller->GetHandle();
     const auto ph = pActivator->GetHandle();
 
-    new CTimer(0.f, false, false, [eh, ph, input, param]() {
+    RunNextTick([eh, ph, input, param]() {
         const auto player = reinterpret_cast<CBaseEntity*>(ph.Get());
         if (const auto entity = reinterpret_cast<CBaseEntity*>(eh.Get()))
             entity->AcceptInput(input, param, player, entity);
-
-        return -1.f;
     });
 }
 
@@ -24,6 +24,9 @@
 #include "cs2_sdk/entity/cbaseentity.h"
 #include "plat.h"
 #include "entity/cgamerules.h"
+#include "ctimer.h"
+#include "playersnapshot.h"
+#include "transmit.h"
 
 extern CGameConfig *g_GameConfig;
 extern CCSGameRules* g_pGameRules;
@@ -40,6 +43,8 @@ void Patch_GetHammerUniqueId(CEntityInstance *pEntity)
 
 void CEntityListener::OnEntitySpawned(CEntityInstance* pEntity)
 {
+	Transmit_OnEntitySpawned(pEntity);
+
 #ifdef _DEBUG
 	const char* pszClassName = pEntity->m_pEntity->m_designerName.String();
 	Message("Entity spawned: %s %s\n", pszClassName, ((CBaseEntity*)pEntity)->m_sUniqueHammerID().Get());
@@ -56,6 +61,12 @@ void CEntityListener::OnEntityCreated(CEntityInstance* pEntity)
 
 void CEntityListener::OnEntityDeleted(CEntityInstance* pEntity)
 {
+	CancelTimers(TimerOwner_t::Entity(pEntity->m_pEntity->m_EHandle.ToInt()));
+
+	if (g_pPlayerSnapshot)
+		g_pPlayerSnapshot->OnEntityDeleted(pEntity);
+
+	Transmit_OnEntityDeleted(pEntity);
 }
 
 void CEntityListener::OnEntityParentChanged(CEntityInstance* pEntity, CEntityInstance* pNewParent)
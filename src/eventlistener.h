@@ -22,6 +22,7 @@
 #include "utlstring.h"
 #include "utlvector.h"
 #include "igameevents.h"
+#include "framebudget.h"
 
 typedef void (*FnEventListenerCallback)(IGameEvent *event);
 
@@ -45,6 +46,7 @@ public:
 	// KeyValue memory will be freed by manager if not needed anymore
 	void FireGameEvent(IGameEvent *event) override
 	{
+		FRAME_PROBE(m_pszEventName);
 		m_Callback(event);
 	}
 
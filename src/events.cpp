@@ -21,6 +21,7 @@
 #include "KeyValues.h"
 #include "commands.h"
 #include "ctimer.h"
+#include "task.h"
 #include "eventlistener.h"
 #include "networkstringtabledefs.h"
 #include "entity/cbaseplayercontroller.h"
@@ -145,22 +146,20 @@ GAME_EVENT_F(player_spawn)
 	CHandle<CCSPlayerController> hController = pController->GetHandle();
 
 	// Gotta do this on the next frame...
-	new CTimer(0.0f, false, false, [hController]()
+	RunNextTick([hController]()
 	{
 		CCSPlayerController *pController = hController.Get();
 
 		if (!pController || !pController->m_bPawnIsAlive())
-			return -1.0f;
+			return;
 
 		CBasePlayerPawn *pPawn = pController->GetPawn();
 
 		// Just in case somehow there's health but the player is, say, an observer
 		if (!pPawn || !pPawn->IsAlive())
-			return -1.0f;
+			return;
 
 		pPawn->SetCollisionGroup(COLLISION_GROUP_DEBRIS);
-
-		return -1.0f;
 	});
 }
 
@@ -250,6 +249,8 @@ GAME_EVENT_F(round_start)
 
 GAME_EVENT_F(round_end)
 {
+	ResumeRoundEndTasks();
+
 	if (g_bVoteManagerEnable)
 	{
 		ConVar* cvar = g_pCVar->GetConVar(g_pCVar->FindConVar("mp_timelimit"));
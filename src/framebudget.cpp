@@ -0,0 +1,185 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framebudget.h"
+#include "common.h"
+#include "tier0/platform.h"
+#include <ctime>
+#include <cstdio>
+
+#include "tier0/memdbgon.h"
+
+static float g_flSpikeBudgetMs = 30.0f;
+static int g_iSpikeLogMaxKB = 1024;
+
+FAKE_FLOAT_CVAR(cs2f_spike_budget_ms, "Ticks taking longer than this many milliseconds get a breakdown written to data/spikes.log, 0 to disable", g_flSpikeBudgetMs, 30.0f, false)
+FAKE_INT_CVAR(cs2f_spike_log_max_kb, "Size in KB at which data/spikes.log is rotated to spikes.log.1", g_iSpikeLogMaxKB, 1024, false)
+
+bool g_bFrameBudgetHotProbes = false;
+
+FAKE_BOOL_CVAR(cs2f_spike_hot_probes, "Whether to also record the per player detours (movement, usercmds, max speed, voice), these can fill the probe buffer on full servers", g_bFrameBudgetHotProbes, false, false)
+
+struct ProbeEntry_t
+{
+	const char *m_pszName;
+	double m_flStart;
+	double m_flEnd;
+	int m_iDepth;
+};
+
+static constexpr int MAX_PROBE_ENTRIES = 4096;
+
+static ProbeEntry_t g_probeEntries[MAX_PROBE_ENTRIES];
+static int g_iProbeCount = 0;
+static int g_iProbeDepth = 0;
+static int g_iDroppedProbes = 0;
+static double g_flTickStart = 0.0;
+static int g_iTickStart = 0;
+static double g_flLastSpikeLog = 0.0;
+static bool g_bResetPending = false;
+
+// Some hooks can run off the main thread, those are simply not recorded
+static thread_local bool t_bRecordingThread = false;
+
+int FrameBudget_Enter(const char *pszName)
+{
+	if (!t_bRecordingThread)
+		return -1;
+
+	if (g_iProbeCount == MAX_PROBE_ENTRIES)
+	{
+		g_iDroppedProbes++;
+		return -1;
+	}
+
+	ProbeEntry_t &entry = g_probeEntries[g_iProbeCount];
+	entry.m_pszName = pszName;
+	entry.m_iDepth = g_iProbeDepth++;
+	entry.m_flEnd = 0.0;
+	entry.m_flStart = Plat_FloatTime();
+
+	return g_iProbeCount++;
+}
+
+void FrameBudget_Exit(int iEntry)
+{
+	if (iEntry < 0)
+		return;
+
+	g_probeEntries[iEntry].m_flEnd = Plat_FloatTime();
+	g_iProbeDepth--;
+}
+
+static void WriteSpike(int iTick, double flTickTime)
+{
+	char szPath[MAX_PATH];
+	V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), "/csgo/addons/cs2fixes/data/spikes.log");
+
+	FILE *pFile = fopen(szPath, "a");
+
+	if (!pFile)
+		return;
+
+	fseek(pFile, 0, SEEK_END);
+
+	if (ftell(pFile) > g_iSpikeLogMaxKB * 1024)
+	{
+		fclose(pFile);
+
+		char szOldPath[MAX_PATH];
+		V_snprintf(szOldPath, sizeof(szOldPath), "%s.1", szPath);
+
+		remove(szOldPath);
+		rename(szPath, szOldPath);
+
+		pFile = fopen(szPath, "a");
+
+		if (!pFile)
+			return;
+	}
+
+	double flPluginTime = 0.0;
+
+	for (int i = 0; i < g_iProbeCount; i++)
+	{
+		if (g_probeEntries[i].m_iDepth == 0 && g_probeEntries[i].m_flEnd != 0.0)
+			flPluginTime += g_probeEntries[i].m_flEnd - g_probeEntries[i].m_flStart;
+	}
+
+	char szTime[64];
+	time_t now = time(nullptr);
+	strftime(szTime, sizeof(szTime), "%Y-%m-%d %H:%M:%S", localtime(&now));
+
+	fprintf(pFile, "[%s] Tick %i took %.2fms (budget %.2fms), CS2Fixes: %.2fms in %i probes%s\n", szTime, iTick, flTickTime * 1000.0,
+		g_flSpikeBudgetMs, flPluginTime * 1000.0, g_iProbeCount, g_iDroppedProbes ? " (buffer full, some probes dropped)" : "");
+
+	for (int i = 0; i < g_iProbeCount; i++)
+	{
+		ProbeEntry_t &entry = g_probeEntries[i];
+
+		// Skip the noise, but always show top level entries
+		double flDuration = entry.m_flEnd != 0.0 ? entry.m_flEnd - entry.m_flStart : 0.0;
+
+		if (entry.m_iDepth > 0 && flDuration < 0.00005)
+			continue;
+
+		fprintf(pFile, "  +%7.3fms %*s%s: %.3fms\n", (entry.m_flStart - g_flTickStart) * 1000.0, entry.m_iDepth * 2, "", entry.m_pszName, flDuration * 1000.0);
+	}
+
+	fclose(pFile);
+}
+
+void FrameBudget_OnGameFrame(bool bSimulating, int iTick)
+{
+	t_bRecordingThread = true;
+
+	double flNow = Plat_FloatTime();
+
+	// A reset only drops the tick in flight, the probes have all been closed by now
+	if (g_bResetPending)
+	{
+		g_bResetPending = false;
+		g_flTickStart = 0.0;
+	}
+
+	// Don't write more than once a second, a long stall would otherwise flood the log with the ticks catching up
+	if (bSimulating && g_flTickStart != 0.0 && g_flSpikeBudgetMs > 0.0f && flNow - g_flLastSpikeLog > 1.0)
+	{
+		double flTickTime = flNow - g_flTickStart;
+
+		if (flTickTime * 1000.0 > g_flSpikeBudgetMs)
+		{
+			WriteSpike(g_iTickStart, flTickTime);
+			g_flLastSpikeLog = Plat_FloatTime();
+			flNow = g_flLastSpikeLog;
+		}
+	}
+
+	g_flTickStart = flNow;
+	g_iTickStart = iTick;
+	g_iProbeCount = 0;
+	g_iProbeDepth = 0;
+	g_iDroppedProbes = 0;
+}
+
+// Probe scopes can still be open here, so the buffer and depth are left for the next game frame to clear
+void FrameBudget_Reset()
+{
+	g_bResetPending = true;
+}
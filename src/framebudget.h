@@ -0,0 +1,67 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Always-on recorder for the time spent in CS2Fixes hooks, detours, timers and event handlers
+// Every probe is timestamped into a per-tick buffer, and ticks that take longer than cs2f_spike_budget_ms
+// get their full breakdown appended to addons/cs2fixes/data/spikes.log
+int FrameBudget_Enter(const char *pszName);
+void FrameBudget_Exit(int iEntry);
+
+// Closes the previous tick and starts recording the next one, must be called first thing in GameFramePost
+void FrameBudget_OnGameFrame(bool bSimulating, int iTick);
+
+// Forget the tick in progress, for when the time since the last frame means nothing (e.g. map change)
+void FrameBudget_Reset();
+
+class CFrameProbe
+{
+public:
+	CFrameProbe(const char *pszName) : m_iEntry(FrameBudget_Enter(pszName)) {}
+	~CFrameProbe() { FrameBudget_Exit(m_iEntry); }
+
+private:
+	int m_iEntry;
+};
+
+// Set by cs2f_spike_hot_probes, off by default since these would run for every player (or pair of players) every tick
+extern bool g_bFrameBudgetHotProbes;
+
+// For detours that run per player, checks the cvar inline so a disabled probe costs a load and a branch
+class CFrameProbeHot
+{
+public:
+	CFrameProbeHot(const char *pszName) : m_iEntry(g_bFrameBudgetHotProbes ? FrameBudget_Enter(pszName) : -1) {}
+	~CFrameProbeHot()
+	{
+		if (m_iEntry >= 0)
+			FrameBudget_Exit(m_iEntry);
+	}
+
+private:
+	int m_iEntry;
+};
+
+#define FRAME_PROBE_CONCAT2(a, b) a##b
+#define FRAME_PROBE_CONCAT(a, b) FRAME_PROBE_CONCAT2(a, b)
+
+// Records the rest of the enclosing scope, the name has to outlive the tick so use literals or other static strings
+#define FRAME_PROBE(name) CFrameProbe FRAME_PROBE_CONCAT(frameProbe_, __LINE__)(name)
+#define FRAME_PROBE_HOT(name) CFrameProbeHot FRAME_PROBE_CONCAT(frameProbe_, __LINE__)(name)
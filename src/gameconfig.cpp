@@ -188,14 +188,24 @@ void *CGameConfig::ResolveSignature(const char *name)
 			return nullptr;
 		}
 
-		size_t iLength = 0;
-		byte *pSignature = HexToByte(signature, iLength);
-		if (!pSignature)
-			return nullptr;
-
 		int error;
+		auto it = m_umScannedSignatures.find(name);
 
-		address = (*module)->FindSignature(pSignature, iLength, error);
+		if (it != m_umScannedSignatures.end())
+		{
+			address = it->second.first;
+			error = it->second.second;
+		}
+		else
+		{
+			size_t iLength = 0;
+			byte *pSignature = HexToByte(signature, iLength);
+			if (!pSignature)
+				return nullptr;
+
+			address = (*module)->FindSignature(pSignature, iLength, error);
+			delete[] pSignature;
+		}
 
 		if (error == SIG_FOUND_MULTIPLE)
 			Panic("!!!!!!!!!! Signature for %s occurs multiple times! Using first match but this might end up crashing!\n", name);
@@ -209,6 +219,50 @@ void *CGameConfig::ResolveSignature(const char *name)
 	return address;
 }
 
+// Looks up every signature in the gamedata with one pass over each module, ResolveSignature then only reads the results
+void CGameConfig::ScanSignatures()
+{
+	std::unordered_map<CModule *, std::vector<std::string>> umNames;
+
+	for (auto &[name, signature] : m_umSignatures)
+	{
+		if (signature.empty() || signature[0] == '@')
+			continue;
+
+		CModule **module = this->GetModule(name.c_str());
+		if (module && *module)
+			umNames[*module].push_back(name);
+	}
+
+	for (auto &[module, names] : umNames)
+	{
+		std::vector<SignatureScan_t> scans;
+		std::vector<std::string> scanNames;
+
+		for (auto &name : names)
+		{
+			size_t iLength = 0;
+			byte *pSignature = HexToByte(m_umSignatures[name].c_str(), iLength);
+			if (!pSignature)
+				continue;
+
+			scans.push_back({ pSignature, iLength, nullptr, SIG_OK });
+			scanNames.push_back(name);
+		}
+
+		double flStart = Plat_FloatTime();
+		module->FindSignatures(scans.data(), (int)scans.size());
+
+		Message("Scanned %s for %d signatures in %.2f ms\n", module->m_pszModule, (int)scans.size(), (Plat_FloatTime() - flStart) * 1000.0);
+
+		for (size_t i = 0; i < scans.size(); i++)
+		{
+			m_umScannedSignatures[scanNames[i]] = std::make_pair(scans[i].m_pAddress, scans[i].m_iError);
+			delete[] scans[i].m_pSignature;
+		}
+	}
+}
+
 // Static functions
 std::string CGameConfig::GetDirectoryName(const std::string &directoryPathInput)
 {
@@ -25,6 +25,7 @@ public:
 	CModule **GetModule(const char *name);
 	bool IsSymbol(const char *name);
 	void *ResolveSignature(const char *name);
+	void ScanSignatures();
 	static std::string GetDirectoryName(const std::string &directoryPathInput);
 	static int HexStringToUint8Array(const char* hexString, uint8_t* byteArray, size_t maxBytes);
 	static byte *HexToByte(const char *src, size_t &length);
@@ -36,6 +37,7 @@ private:
 	std::unordered_map<std::string, int> m_umOffsets;
 	std::unordered_map<std::string, std::string> m_umSignatures;
 	std::unordered_map<std::string, void*> m_umAddresses;
+	std::unordered_map<std::string, std::pair<void*, int>> m_umScannedSignatures;
 	std::unordered_map<std::string, std::string> m_umLibraries;
 	std::unordered_map<std::string, std::string> m_umPatches;
 };
@@ -23,11 +23,13 @@
 #include "gamesystem.h"
 #include "zombiereborn.h"
 #include "playermanager.h"
+#include "playersnapshot.h"
 #include "leader.h"
 #include "adminsystem.h"
 #include "entities.h"
 #include "tier0/vprof.h"
 #include "idlemanager.h"
+#include "framebudget.h"
 
 #include "tier0/memdbgon.h"
 
@@ -89,6 +91,10 @@ GS_EVENT_MEMBER(CGameSystem, BuildGameSessionManifest)
 GS_EVENT_MEMBER(CGameSystem, ServerPreEntityThink)
 {
 	VPROF_BUDGET("CGameSystem::ServerPreEntityThink", "CS2FixesPerFrame")
+	FRAME_PROBE("CGameSystem::ServerPreEntityThink");
+
+	// Flashlights and idle times go by the state before this tick's think, like when they read the pawns themselves
+	g_pPlayerSnapshot->Update();
 	g_playerManager->FlashLightThink();
 	g_pIdleSystem->UpdateIdleTimes();
 	EntityHandler_OnGameFramePre(gpGlobals->m_bInSimulation, gpGlobals->tickcount);
@@ -98,5 +104,9 @@ GS_EVENT_MEMBER(CGameSystem, ServerPreEntityThink)
 GS_EVENT_MEMBER(CGameSystem, ServerPostEntityThink)
 {
 	VPROF_BUDGET("CGameSystem::ServerPostEntityThink", "CS2FixesPerFrame")
+	FRAME_PROBE("CGameSystem::ServerPostEntityThink");
+
+	// Again for player states and CheckTransmit, which need where everyone ended up after thinking
+	g_pPlayerSnapshot->Update();
 	g_playerManager->UpdatePlayerStates();
 }
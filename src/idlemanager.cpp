@@ -19,6 +19,7 @@
 
 #include "idlemanager.h"
 #include "commands.h"
+#include "playersnapshot.h"
 #include <vprof.h>
 
 extern IVEngineServer2 *g_pEngineServer2;
@@ -95,16 +96,12 @@ void CIdleSystem::UpdateIdleTimes()
 
 	for (int i = 0; i < gpGlobals->maxClients; i++)
 	{
-		ZEPlayer* pPlayer = g_playerManager->GetPlayer(i);
+		ZEPlayer* pPlayer = g_pPlayerSnapshot->m_pZEPlayer[i];
 
 		if (!pPlayer)
 			continue;
 
-		CBasePlayerController* pTarget = (CBasePlayerController*)g_pEntitySystem->GetEntityInstance((CEntityIndex)(pPlayer->GetPlayerSlot().Get() + 1));
-		if (!pTarget)
-			continue;
-
-		const auto pPawn = pTarget->m_hPawn();
+		const auto pPawn = g_pPlayerSnapshot->m_pPawn[i];
 		if (!pPawn)
 			continue;
 
@@ -0,0 +1,244 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "jobscheduler.h"
+#include "common.h"
+#include "tier0/platform.h"
+#include "framebudget.h"
+#include <vprof.h>
+
+#include "tier0/memdbgon.h"
+
+extern CGlobalVars *gpGlobals;
+extern double g_flUniversalTime;
+
+CJobScheduler *g_pJobScheduler = nullptr;
+
+static int g_iJobBudgetUs = 1000;
+static int g_iJobPlayersPerTick = 8;
+
+FAKE_INT_CVAR(cs2f_job_budget_us, "Microseconds per tick that periodic jobs may use before the rest is pushed to the next tick", g_iJobBudgetUs, 1000, false)
+FAKE_INT_CVAR(cs2f_job_players_per_tick, "How many players a per-player periodic job processes per tick", g_iJobPlayersPerTick, 8, false)
+
+int CJobScheduler::AllocJob(const char *pszName, float flInterval, bool bPreserveMapChange)
+{
+	int iJob = -1;
+
+	FOR_EACH_VEC(m_vecJobs, i)
+	{
+		if (!m_vecJobs[i].IsActive())
+		{
+			iJob = i;
+			break;
+		}
+	}
+
+	if (iJob == -1)
+		iJob = m_vecJobs.AddToTail();
+
+	// Offset every new job's first run by the golden ratio sequence within its first interval, so jobs with the same or related intervals start out of phase
+	float flPhase = (m_iJobsAdded++ * 0.6180339f);
+	flPhase -= (int)flPhase;
+
+	Job_t &job = m_vecJobs[iJob];
+	job.m_pszName = pszName;
+	job.m_flInterval = flInterval;
+	job.m_bPreserveMapChange = bPreserveMapChange;
+	job.m_pfnJob = nullptr;
+	job.m_pfnTimedJob = nullptr;
+	job.m_pfnPlayer = nullptr;
+	job.m_pfnFinish = nullptr;
+	job.m_flNextRun = g_flUniversalTime + flInterval * flPhase;
+	job.m_iCursor = -1;
+	job.m_flLastUs = 0.0f;
+	job.m_flMaxUs = 0.0f;
+	job.m_flCurrentUs = 0.0f;
+
+	return iJob;
+}
+
+int CJobScheduler::AddJob(const char *pszName, float flInterval, bool bPreserveMapChange, JobFunc_t pfnJob)
+{
+	int iJob = AllocJob(pszName, flInterval, bPreserveMapChange);
+	m_vecJobs[iJob].m_pfnJob = pfnJob;
+
+	return iJob;
+}
+
+int CJobScheduler::AddJob(const char *pszName, float flInterval, bool bPreserveMapChange, TimedJobFunc_t pfnJob)
+{
+	int iJob = AllocJob(pszName, flInterval, bPreserveMapChange);
+	m_vecJobs[iJob].m_pfnTimedJob = pfnJob;
+
+	return iJob;
+}
+
+int CJobScheduler::AddPlayerJob(const char *pszName, float flInterval, bool bPreserveMapChange, PlayerJobFunc_t pfnPlayer, JobFunc_t pfnFinish)
+{
+	int iJob = AllocJob(pszName, flInterval, bPreserveMapChange);
+	m_vecJobs[iJob].m_pfnPlayer = pfnPlayer;
+	m_vecJobs[iJob].m_pfnFinish = pfnFinish;
+
+	return iJob;
+}
+
+void CJobScheduler::RemoveJob(int iJob)
+{
+	if (!m_vecJobs.IsValidIndex(iJob))
+		return;
+
+	m_vecJobs[iJob].m_pfnJob = nullptr;
+	m_vecJobs[iJob].m_pfnTimedJob = nullptr;
+	m_vecJobs[iJob].m_pfnPlayer = nullptr;
+}
+
+void CJobScheduler::RemoveMapJobs()
+{
+	FOR_EACH_VEC(m_vecJobs, i)
+	{
+		if (!m_vecJobs[i].m_bPreserveMapChange)
+			RemoveJob(i);
+	}
+}
+
+void CJobScheduler::RunFrame()
+{
+	if (!gpGlobals || !m_vecJobs.Count())
+		return;
+
+	VPROF("CJobScheduler::RunFrame");
+
+	double flStart = Plat_FloatTime();
+	double flBudget = g_iJobBudgetUs / 1000000.0;
+	int iPlayersPerTick = MAX(g_iJobPlayersPerTick, 1);
+	int iJobCount = m_vecJobs.Count();
+	bool bStartedJob = false;
+
+	// Rotate the starting job so a busy job at the front can't keep the others waiting on the budget
+	int iFirstJob = m_iNextJob % iJobCount;
+	m_iNextJob = iFirstJob + 1;
+
+	for (int n = 0; n < iJobCount; n++)
+	{
+		int iJob = (iFirstJob + n) % iJobCount;
+		Job_t *pJob = &m_vecJobs[iJob];
+
+		if (!pJob->IsActive())
+			continue;
+
+		if (pJob->m_iCursor == -1)
+		{
+			// Only one job starts per tick, jobs that come due together drift apart instead of stacking up on one frame
+			if (bStartedJob || pJob->m_flNextRun > g_flUniversalTime)
+				continue;
+
+			bStartedJob = true;
+
+			// Keep the phase unless we fell behind by a whole interval
+			pJob->m_flNextRun += pJob->m_flInterval;
+
+			if (pJob->m_flNextRun <= g_flUniversalTime)
+				pJob->m_flNextRun = g_flUniversalTime + pJob->m_flInterval;
+
+			pJob->m_iCursor = 0;
+			pJob->m_flCurrentUs = 0.0f;
+		}
+
+		FRAME_PROBE(pJob->m_pszName);
+		double flJobStart = Plat_FloatTime();
+
+		// A callback may add jobs and reallocate m_vecJobs, so the job is looked up again after every call
+		if (pJob->m_pfnJob)
+		{
+			pJob->m_pfnJob();
+
+			pJob = &m_vecJobs[iJob];
+			pJob->m_iCursor = gpGlobals->maxClients;
+		}
+		else if (pJob->m_pfnTimedJob)
+		{
+			float flInterval = pJob->m_pfnTimedJob();
+
+			pJob = &m_vecJobs[iJob];
+			pJob->m_iCursor = gpGlobals->maxClients;
+
+			if (flInterval < 0.0f)
+			{
+				RemoveJob(iJob);
+			}
+			else
+			{
+				pJob->m_flInterval = flInterval;
+				pJob->m_flNextRun = g_flUniversalTime + flInterval;
+			}
+		}
+		else
+		{
+			int iEnd = MIN(pJob->m_iCursor + iPlayersPerTick, gpGlobals->maxClients);
+
+			while (pJob->m_iCursor < iEnd && pJob->m_pfnPlayer)
+			{
+				int iSlot = pJob->m_iCursor++;
+				pJob->m_pfnPlayer(iSlot);
+				pJob = &m_vecJobs[iJob];
+			}
+
+			if (pJob->m_iCursor >= gpGlobals->maxClients && pJob->m_pfnFinish)
+			{
+				pJob->m_pfnFinish();
+				pJob = &m_vecJobs[iJob];
+			}
+		}
+
+		double flNow = Plat_FloatTime();
+		pJob->m_flCurrentUs += (flNow - flJobStart) * 1000000.0;
+
+		if (pJob->m_iCursor >= gpGlobals->maxClients)
+		{
+			pJob->m_iCursor = -1;
+			pJob->m_flLastUs = pJob->m_flCurrentUs;
+			pJob->m_flMaxUs = MAX(pJob->m_flMaxUs, pJob->m_flCurrentUs);
+		}
+
+		if (flNow - flStart >= flBudget)
+			break;
+	}
+}
+
+void CJobScheduler::PrintJobs()
+{
+	Message("Periodic jobs (budget %ius per tick, %i players per tick):\n", g_iJobBudgetUs, g_iJobPlayersPerTick);
+
+	FOR_EACH_VEC(m_vecJobs, i)
+	{
+		Job_t &job = m_vecJobs[i];
+
+		if (!job.IsActive())
+			continue;
+
+		Message("  %-24s every %.2fs, next in %.2fs%s, last %.0fus, max %.0fus\n", job.m_pszName, job.m_flInterval,
+			job.m_flNextRun - g_flUniversalTime, job.m_iCursor != -1 ? " (running)" : "", job.m_flLastUs, job.m_flMaxUs);
+	}
+}
+
+CON_COMMAND_F(cs2f_jobs, "List periodic jobs and how long they take", FCVAR_LINKED_CONCOMMAND | FCVAR_SPONLY)
+{
+	if (g_pJobScheduler)
+		g_pJobScheduler->PrintJobs();
+}
@@ -0,0 +1,74 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "utlvector.h"
+
+// Periodic work that doesn't have to land on an exact tick, use this instead of a repeating CTimer
+// Jobs are staggered so they don't fire on the same frame, per-player jobs are processed a few slots per tick
+// and everything shares a per-tick time budget
+typedef void (*JobFunc_t)();
+typedef float (*TimedJobFunc_t)();
+typedef void (*PlayerJobFunc_t)(int iSlot);
+
+class CJobScheduler
+{
+public:
+	CJobScheduler() : m_iNextJob(0), m_iJobsAdded(0) {}
+
+	int AddJob(const char *pszName, float flInterval, bool bPreserveMapChange, JobFunc_t pfnJob);
+
+	// Like a CTimer, pfnJob returns the time until its next run, or a negative value like -1.0f to stop
+	int AddJob(const char *pszName, float flInterval, bool bPreserveMapChange, TimedJobFunc_t pfnJob);
+
+	// pfnPlayer gets called for every player slot once per interval, then pfnFinish (if any) after the last one
+	int AddPlayerJob(const char *pszName, float flInterval, bool bPreserveMapChange, PlayerJobFunc_t pfnPlayer, JobFunc_t pfnFinish = nullptr);
+
+	void RemoveJob(int iJob);
+	void RemoveMapJobs();
+	void RunFrame();
+	void PrintJobs();
+
+private:
+	struct Job_t
+	{
+		const char *m_pszName;
+		float m_flInterval;
+		bool m_bPreserveMapChange;
+		JobFunc_t m_pfnJob;
+		TimedJobFunc_t m_pfnTimedJob;
+		PlayerJobFunc_t m_pfnPlayer;
+		JobFunc_t m_pfnFinish;
+		double m_flNextRun;
+		int m_iCursor; // Next player slot to process, -1 if the job is waiting for its next run
+		float m_flLastUs; // Time spent over the last full run
+		float m_flMaxUs;
+		float m_flCurrentUs;
+
+		bool IsActive() { return m_pfnJob || m_pfnTimedJob || m_pfnPlayer; }
+	};
+
+	int AllocJob(const char *pszName, float flInterval, bool bPreserveMapChange);
+
+	CUtlVector<Job_t> m_vecJobs;
+	int m_iNextJob;
+	int m_iJobsAdded;
+};
+
+extern CJobScheduler *g_pJobScheduler;
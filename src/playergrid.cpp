@@ -0,0 +1,91 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "playergrid.h"
+#include "playersnapshot.h"
+#include <cmath>
+
+#include "tier0/memdbgon.h"
+
+extern CGlobalVars *gpGlobals;
+
+static float g_flHideGridCellSize = 256.0f;
+
+FAKE_FLOAT_CVAR(cs2f_hide_grid_cell_size, "Cell size of the grid hide uses to find nearby players, roughly the most common hide distance works best", g_flHideGridCellSize, 256.0f, false)
+
+// Well within int range and exactly representable as a float, NaN ends up at the low end
+static int ClampCell(float flCell)
+{
+	return (int)MIN(MAX(flCell, -16777216.0f), 16777216.0f);
+}
+
+void CPlayerGrid::Build()
+{
+	if (m_iSerial == g_pPlayerSnapshot->GetSerial())
+		return;
+
+	m_iSerial = g_pPlayerSnapshot->GetSerial();
+	m_flCellSize = MAX(g_flHideGridCellSize, 32.0f);
+	m_nMask = 0;
+	V_memset(m_nBuckets, 0, sizeof(m_nBuckets));
+
+	for (int i = 0; i < gpGlobals->maxClients; i++)
+	{
+		if (!g_pPlayerSnapshot->m_pPlayerPawn[i])
+			continue;
+
+		uint64 nBit = (uint64)1 << i;
+
+		// Teleports can put players anywhere, so this goes through the same clamp as queries
+		int x = ClampCell(floorf(g_pPlayerSnapshot->m_flOriginX[i] / m_flCellSize));
+		int y = ClampCell(floorf(g_pPlayerSnapshot->m_flOriginY[i] / m_flCellSize));
+
+		m_nBuckets[GetBucket(x, y)] |= nBit;
+		m_nMask |= nBit;
+	}
+}
+
+uint64 CPlayerGrid::Query(const Vector &vecOrigin, float flRadius)
+{
+	// Stay in floats until the range is known to be small, a huge radius would overflow the conversion to int
+	float flMinX = floorf((vecOrigin.x - flRadius) / m_flCellSize);
+	float flMaxX = floorf((vecOrigin.x + flRadius) / m_flCellSize);
+	float flMinY = floorf((vecOrigin.y - flRadius) / m_flCellSize);
+	float flMaxY = floorf((vecOrigin.y + flRadius) / m_flCellSize);
+
+	// Past this point every bucket would be visited anyway, written so NaN ends up here too
+	if (!((flMaxX - flMinX + 1.0f) * (flMaxY - flMinY + 1.0f) < BUCKET_COUNT))
+		return m_nMask;
+
+	// The range is small now but could still sit far outside any map, only the hash of the cell matters so clamping is fine
+	int iMinX = ClampCell(flMinX);
+	int iMaxX = ClampCell(flMaxX);
+	int iMinY = ClampCell(flMinY);
+	int iMaxY = ClampCell(flMaxY);
+
+	uint64 nMask = 0;
+
+	for (int x = iMinX; x <= iMaxX; x++)
+	{
+		for (int y = iMinY; y <= iMaxY; y++)
+			nMask |= m_nBuckets[GetBucket(x, y)];
+	}
+
+	return nMask;
+}
@@ -0,0 +1,46 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "common.h"
+#include "mathlib/vector.h"
+
+// Uniform grid of player pawn positions for radius queries, rebuilt at most once per update of the player snapshot
+// Cells are hashed on x/y so no map bounds are needed, every bucket is a mask of player slots
+// Hash collisions and the missing z axis only add candidates, callers still do the exact distance check
+class CPlayerGrid
+{
+public:
+	CPlayerGrid() : m_nMask(0), m_flCellSize(256.0f), m_iSerial(-1) {}
+
+	void Build();
+
+	// Slots whose pawn might be within flRadius of vecOrigin
+	uint64 Query(const Vector &vecOrigin, float flRadius);
+
+private:
+	static constexpr int BUCKET_COUNT = 256;
+
+	int GetBucket(int x, int y) { return ((uint32)x * 73856093u ^ (uint32)y * 19349663u) & (BUCKET_COUNT - 1); }
+
+	uint64 m_nBuckets[BUCKET_COUNT];
+	uint64 m_nMask;
+	float m_flCellSize;
+	int m_iSerial;
+};
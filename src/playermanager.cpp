@@ -20,6 +20,8 @@
 #include <../cs2fixes.h>
 #include "utlstring.h"
 #include "playermanager.h"
+#include "playersnapshot.h"
+#include "proximity.h"
 #include "adminsystem.h"
 #include "commands.h"
 #include "map_votes.h"
@@ -296,7 +298,7 @@ void ZEPlayer::StartBeacon(Color color, ZEPlayerHandle hGiver/* = 0*/)
 	if (pGiver && pGiver->IsLeader())
 		bLeaderBeacon = true;
 
-	new CTimer(1.0f, false, false, [hPlayer, hParticle, hGiver, iTeamNum, bLeaderBeacon]()
+	new CTimer(1.0f, false, false, TimerOwner_t::Player(m_slot.Get()), [hPlayer, hParticle, hGiver, iTeamNum, bLeaderBeacon]()
 	{
 		CParticleSystem *pParticle = hParticle.Get();
 
@@ -422,7 +424,7 @@ void ZEPlayer::StartGlow(Color color, int duration)
 	int iTeamNum = hPawn->m_iTeamNum();
 
 	// check if player's team or model changed
-	new CTimer(0.5f, false, false, [hGlowModel, hPawn, iTeamNum]()
+	new CTimer(0.5f, false, false, TimerOwner_t::Entity(hGlowModel.ToInt()), [hGlowModel, hPawn, iTeamNum]()
 	{
 		CBaseModelEntity *pModel = hGlowModel.Get();
 		CCSPlayerPawn *pawn = hPawn.Get();
@@ -452,7 +454,7 @@ void ZEPlayer::StartGlow(Color color, int duration)
 	if (duration < 1)
 		return;
 	
-	new CTimer((float)duration, false, false, [hGlowModel]()
+	new CTimer((float)duration, false, false, TimerOwner_t::Entity(hGlowModel.ToInt()), [hGlowModel]()
 	{
 		CBaseModelEntity *pModel = hGlowModel.Get();
 
@@ -556,8 +558,13 @@ void CPlayerManager::OnClientDisconnect(CPlayerSlot slot)
 	g_pUserPreferencesSystem->PushPreferences(slot.Get());
 	g_pUserPreferencesSystem->ClearPreferences(slot.Get());
 
+	// Anything still scheduled for this player would only find an invalid handle from now on
+	CancelTimers(TimerOwner_t::Player(slot.Get()));
+
 	delete m_vecPlayers[slot.Get()];
 	m_vecPlayers[slot.Get()] = nullptr;
+	g_pPlayerSnapshot->ClearSlot(slot.Get());
+	ResetHideState(slot.Get());
 
 	ResetPlayerFlags(slot.Get());
 
@@ -649,17 +656,14 @@ void CPlayerManager::OnValidateAuthTicket(ValidateAuthTicketResponse_t *pRespons
 	}
 }
 
-void CPlayerManager::CheckInfractions()
+void CPlayerManager::CheckInfractions(int iSlot)
 {
-	for (int i = 0; i < gpGlobals->maxClients; i++)
-	{
-		if (m_vecPlayers[i] == nullptr || m_vecPlayers[i]->IsFakeClient())
-			continue;
+	ZEPlayer *pPlayer = m_vecPlayers[iSlot];
 
-		m_vecPlayers[i]->CheckInfractions();
-	}
+	if (pPlayer == nullptr || pPlayer->IsFakeClient())
+		return;
 
-	g_pAdminSystem->SaveInfractions();
+	pPlayer->CheckInfractions();
 }
 
 static bool g_bFlashLightEnable = false;
@@ -675,77 +679,119 @@ void CPlayerManager::FlashLightThink()
 
 	for (int i = 0; i < gpGlobals->maxClients; i++)
 	{
-		CCSPlayerController *pPlayer = CCSPlayerController::FromSlot(i);
-
-		if (!pPlayer || !pPlayer->m_bPawnIsAlive())
+		if (!g_pPlayerSnapshot->m_bAlive[i] || !g_pPlayerSnapshot->m_pZEPlayer[i])
 			continue;
 
-		uint64 *pButtons = pPlayer->GetPawn()->m_pMovementServices->m_nButtons().m_pButtonStates();
+		uint64 *pButtons = g_pPlayerSnapshot->m_pPlayerPawn[i]->m_pMovementServices->m_nButtons().m_pButtonStates();
 
 		// Check both to make sure flashlight is only toggled when the player presses the key
 		if ((pButtons[0] & IN_LOOK_AT_WEAPON) && (pButtons[1] & IN_LOOK_AT_WEAPON))
-			pPlayer->GetZEPlayer()->ToggleFlashLight();
+			g_pPlayerSnapshot->m_pZEPlayer[i]->ToggleFlashLight();
 	}
 }
 
 static bool g_bHideTeammatesOnly = false;
+static int g_iHideUpdateTicks = 32;
+static float g_flHideMoveThreshold = 16.0f;
+static float g_flHideHysteresis = 32.0f;
 
 FAKE_BOOL_CVAR(cs2f_hide_teammates_only, "Whether to hide teammates only", g_bHideTeammatesOnly, false, false)
+FAKE_INT_CVAR(cs2f_hide_update_ticks, "How many ticks between hide updates, 1 to update every tick", g_iHideUpdateTicks, 32, false)
+FAKE_FLOAT_CVAR(cs2f_hide_move_threshold, "How far a player has to move before hide looks at them again", g_flHideMoveThreshold, 16.0f, false)
+FAKE_FLOAT_CVAR(cs2f_hide_hysteresis, "How much further than their hide distance a hidden player has to get before showing up again", g_flHideHysteresis, 32.0f, false)
 
 void CPlayerManager::CheckHideDistances()
 {
-	if (!g_pEntitySystem)
+	if (!g_pEntitySystem || gpGlobals->tickcount % MAX(g_iHideUpdateTicks, 1))
 		return;
 
 	VPROF("CPlayerManager::CheckHideDistances");
 
+	// Players that moved past the threshold, changed team or gained/lost their pawn since hide last looked at them
+	// Only pairs involving one of these get evaluated again, everyone else keeps their previous result
+	uint64 nDirty = 0;
+	uint64 nPawnMask = 0;
+
 	for (int i = 0; i < gpGlobals->maxClients; i++)
 	{
-		auto player = GetPlayer(i);
+		uint64 nBit = (uint64)1 << i;
+		bool bHasPawn = g_pPlayerSnapshot->m_pPlayerPawn[i] != nullptr;
+		Vector vecOrigin = g_pPlayerSnapshot->GetOrigin(i);
+		HideState_t &state = m_hideStates[i];
+
+		if (bHasPawn)
+			nPawnMask |= nBit;
 
-		if (!player)
+		if (bHasPawn == state.m_bHasPawn && g_pPlayerSnapshot->m_iTeamNum[i] == state.m_iTeamNum &&
+			vecOrigin.DistToSqr(state.m_vecOrigin) <= g_flHideMoveThreshold * g_flHideMoveThreshold)
 			continue;
 
-		player->ClearTransmit();
-		auto hideDistance = player->GetHideDistance();
+		nDirty |= nBit;
+		state.m_vecOrigin = vecOrigin;
+		state.m_iTeamNum = g_pPlayerSnapshot->m_iTeamNum[i];
+		state.m_bHasPawn = bHasPawn;
+	}
 
-		if (!hideDistance)
-			continue;
+	bool bRecomputeAll = g_bHideTeammatesOnly != m_bHideTeammatesOnly;
+	m_bHideTeammatesOnly = g_bHideTeammatesOnly;
 
-		CCSPlayerController* pController = CCSPlayerController::FromSlot(i);
+	m_PlayerGrid.Build();
 
-		if (!pController)
+	for (int i = 0; i < gpGlobals->maxClients; i++)
+	{
+		ZEPlayer *pPlayer = GetPlayer(i);
+
+		if (!pPlayer)
 			continue;
 
-		auto pPawn = pController->GetPawn();
+		uint64 nBit = (uint64)1 << i;
+		HideState_t &state = m_hideStates[i];
+		int iHideDistance = g_pPlayerSnapshot->m_bAlive[i] ? pPlayer->GetHideDistance() : 0;
 
-		if (!pPawn || !pPawn->IsAlive())
+		if (!iHideDistance)
+		{
+			pPlayer->ClearTransmit();
+			state.m_iHideDistance = 0;
 			continue;
+		}
 
-		auto vecPosition = pPawn->GetAbsOrigin();
-		int team = pController->m_iTeamNum;
+		uint64 nPrevious = pPlayer->GetBlockTransmitMask();
+		uint64 nRecompute = (nDirty & nBit) ? ~(uint64)0 : nDirty;
 
-		for (int j = 0; j < gpGlobals->maxClients; j++)
+		// A new distance should apply right away, so don't let hysteresis keep anyone hidden
+		if (bRecomputeAll || iHideDistance != state.m_iHideDistance)
 		{
-			if (j == i)
-				continue;
+			nPrevious = 0;
+			nRecompute = ~(uint64)0;
+			state.m_iHideDistance = iHideDistance;
+		}
 
-			CCSPlayerController* pTargetController = CCSPlayerController::FromSlot(j);
+		if (!nRecompute)
+			continue;
 
-			if (pTargetController)
-			{
-				auto pTargetPawn = pTargetController->GetPawn();
+		Vector vecPosition = g_pPlayerSnapshot->GetOrigin(i);
+		float flShowDistance = iHideDistance + MAX(g_flHideHysteresis, 0.0f);
 
-				// TODO: Unhide dead pawns if/when valve fixes the crash
-				if (pTargetPawn && (!g_bHideTeammatesOnly || pTargetController->m_iTeamNum == team))
-				{
-					player->SetTransmit(j, pTargetPawn->GetAbsOrigin().DistToSqr(vecPosition) <= hideDistance * hideDistance);
-				}
-			}
-		}
+		// TODO: Unhide dead pawns if/when valve fixes the crash
+		uint64 nCandidates = nRecompute & nPawnMask & ~nBit & m_PlayerGrid.Query(vecPosition, flShowDistance);
+
+		if (g_bHideTeammatesOnly)
+			nCandidates &= g_pPlayerSnapshot->GetTeamMask(g_pPlayerSnapshot->m_iTeamNum[i]);
+
+		// Players get hidden once they're within the hide distance, but only show up again past the hysteresis band
+		const float *pX = g_pPlayerSnapshot->m_flOriginX, *pY = g_pPlayerSnapshot->m_flOriginY, *pZ = g_pPlayerSnapshot->m_flOriginZ;
+		uint64 nHidden = Proximity_Query(pX, pY, pZ, gpGlobals->maxClients, vecPosition, iHideDistance, nCandidates);
+		uint64 nStillHidden = Proximity_Query(pX, pY, pZ, gpGlobals->maxClients, vecPosition, flShowDistance, nCandidates & nPrevious);
+
+		pPlayer->SetTransmitMask((nPrevious & ~nRecompute) | nHidden | nStillHidden);
 	}
 }
 
+void CPlayerManager::ResetHideState(int iSlot)
+{
+	m_hideStates[iSlot] = HideState_t();
+}
+
 static const char *g_szPlayerStates[] =
 {
 	"STATE_ACTIVE",
@@ -765,18 +811,14 @@ void CPlayerManager::UpdatePlayerStates()
 {
 	for (int i = 0; i < gpGlobals->maxClients; i++)
 	{
-		ZEPlayer *pPlayer = GetPlayer(i);
+		ZEPlayer *pPlayer = g_pPlayerSnapshot->m_pZEPlayer[i];
 
 		if (!pPlayer)
 			continue;
 
-		CCSPlayerController *pController = CCSPlayerController::FromSlot(i);
-
-		if (!pController)
-			continue;
-
+		CCSPlayerController *pController = g_pPlayerSnapshot->m_pController[i];
 		uint32 iPreviousPlayerState = pPlayer->GetPlayerState();
-		uint32 iCurrentPlayerState = pController->GetPawnState();
+		uint32 iCurrentPlayerState = g_pPlayerSnapshot->m_iPawnState[i];
 
 		if (iCurrentPlayerState != iPreviousPlayerState)
 		{
@@ -800,49 +842,41 @@ void CPlayerManager::UpdatePlayerStates()
 static bool g_bInfiniteAmmo = false;
 FAKE_BOOL_CVAR(cs2f_infinite_reserve_ammo, "Whether to enable infinite reserve ammo on weapons", g_bInfiniteAmmo, false, false)
 
-void CPlayerManager::SetupInfiniteAmmo()
+void CPlayerManager::InfiniteAmmoThink(int iSlot)
 {
-	new CTimer(5.0f, false, true, []()
-	{
-		if (!g_bInfiniteAmmo)
-			return 5.0f;
+	if (!g_bInfiniteAmmo)
+		return;
 
-		VPROF("CPlayerManager::InfiniteAmmoTimer");
+	VPROF("CPlayerManager::InfiniteAmmoThink");
 
-		for (int i = 0; i < gpGlobals->maxClients; i++)
-		{
-			CCSPlayerController* pController = CCSPlayerController::FromSlot(i);
+	CCSPlayerController* pController = CCSPlayerController::FromSlot(iSlot);
 
-			if (!pController)
-				continue;
+	if (!pController)
+		return;
 
-			auto pPawn = pController->GetPawn();
+	auto pPawn = pController->GetPawn();
 
-			if (!pPawn)
-				continue;
+	if (!pPawn)
+		return;
 
-			CCSPlayer_WeaponServices* pWeaponServices = pPawn->m_pWeaponServices;
+	CCSPlayer_WeaponServices* pWeaponServices = pPawn->m_pWeaponServices;
 
-			// it can sometimes be null when player joined on the very first round? 
-			if (!pWeaponServices)
-				continue;
-
-			CUtlVector<CHandle<CBasePlayerWeapon>>* weapons = pWeaponServices->m_hMyWeapons();
+	// it can sometimes be null when player joined on the very first round? 
+	if (!pWeaponServices)
+		return;
 
-			FOR_EACH_VEC(*weapons, i)
-			{
-				CBasePlayerWeapon* weapon = (*weapons)[i].Get();
+	CUtlVector<CHandle<CBasePlayerWeapon>>* weapons = pWeaponServices->m_hMyWeapons();
 
-				if (!weapon)
-					continue;
+	FOR_EACH_VEC(*weapons, i)
+	{
+		CBasePlayerWeapon* weapon = (*weapons)[i].Get();
 
-				if (weapon->GetWeaponVData()->m_GearSlot() == GEAR_SLOT_RIFLE || weapon->GetWeaponVData()->m_GearSlot() == GEAR_SLOT_PISTOL)
-					weapon->AcceptInput("SetReserveAmmoAmount", "999"); // 999 will be automatically clamped to the weapons m_nPrimaryReserveAmmoMax
-			}
-		}
+		if (!weapon)
+			continue;
 
-		return 5.0f;
-	});
+		if (weapon->GetWeaponVData()->m_GearSlot() == GEAR_SLOT_RIFLE || weapon->GetWeaponVData()->m_GearSlot() == GEAR_SLOT_PISTOL)
+			weapon->AcceptInput("SetReserveAmmoAmount", "999"); // 999 will be automatically clamped to the weapons m_nPrimaryReserveAmmoMax
+	}
 }
 
 ETargetType CPlayerManager::TargetPlayerString(int iCommandClient, const char* target, int& iNumClients, int *clients)
@@ -28,6 +28,7 @@
 #include "entity/lights.h"
 #include "entity/cparticlesystem.h"
 #include "gamesystem.h"
+#include "playergrid.h"
 
 #define DECAL_PREF_KEY_NAME "hide_decals"
 #define HIDE_DISTANCE_PREF_KEY_NAME "hide_distance"
@@ -151,6 +152,7 @@ public:
 	void SetGagged(bool gagged) { m_bGagged = gagged; }
 	void SetTransmit(int index, bool shouldTransmit) { shouldTransmit ? m_shouldTransmit.Set(index) : m_shouldTransmit.Clear(index); }
 	void ClearTransmit() { m_shouldTransmit.ClearAll(); }
+	void SetTransmitMask(uint64 nMask) { m_shouldTransmit.SetDWord(0, (uint32)nMask); m_shouldTransmit.SetDWord(1, (uint32)(nMask >> 32)); }
 	void SetHideDistance(int distance);
 	void SetTotalDamage(int damage) { m_iTotalDamage = damage; }
 	void SetTotalHits(int hits) { m_iTotalHits = hits; }
@@ -180,6 +182,7 @@ public:
 	bool IsMuted() { return m_bMuted; }
 	bool IsGagged() { return m_bGagged; }
 	bool ShouldBlockTransmit(int index) { return m_shouldTransmit.Get(index); }
+	uint64 GetBlockTransmitMask() { return m_shouldTransmit.GetDWord(0) | ((uint64)m_shouldTransmit.GetDWord(1) << 32); }
 	int GetHideDistance();
 	CPlayerSlot GetPlayerSlot() { return m_slot; }
 	int GetTotalDamage() { return m_iTotalDamage; }
@@ -284,10 +287,11 @@ public:
 	void OnClientPutInServer(CPlayerSlot slot);
 	void OnLateLoad();
 	void OnSteamAPIActivated();
-	void CheckInfractions();
+	void CheckInfractions(int iSlot);
 	void FlashLightThink();
 	void CheckHideDistances();
-	void SetupInfiniteAmmo();
+	void ResetHideState(int iSlot);
+	void InfiniteAmmoThink(int iSlot);
 	CPlayerSlot GetSlotFromUserId(uint16 userid);
 	ZEPlayer *GetPlayerFromUserId(uint16 userid);
 	ZEPlayer *GetPlayerFromSteamId(uint64 steamid);
@@ -315,6 +319,19 @@ public:
 
 private:
 	ZEPlayer *m_vecPlayers[MAXPLAYERS];
+	CPlayerGrid m_PlayerGrid;
+
+	// What hide last saw of each player, see CheckHideDistances
+	struct HideState_t
+	{
+		Vector m_vecOrigin = Vector(0, 0, 0);
+		int m_iHideDistance = 0;
+		uint8 m_iTeamNum = CS_TEAM_NONE;
+		bool m_bHasPawn = false;
+	};
+
+	HideState_t m_hideStates[MAXPLAYERS];
+	bool m_bHideTeammatesOnly = false;
 
 	uint64 m_nUsingStopSound;
 	uint64 m_nUsingSilenceSound;
@@ -0,0 +1,187 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "playersnapshot.h"
+#include "playermanager.h"
+#include "entity/ccsplayercontroller.h"
+#include "entity/ccsplayerpawn.h"
+#include "tier0/vprof.h"
+
+#include "tier0/memdbgon.h"
+
+extern CGlobalVars *gpGlobals;
+extern CGameEntitySystem *g_pEntitySystem;
+
+CPlayerSnapshot *g_pPlayerSnapshot = nullptr;
+
+void CPlayerSnapshot::Clear()
+{
+	m_nValidMask = 0;
+	m_nViewMask = 0;
+	V_memset(m_nTeamMask, 0, sizeof(m_nTeamMask));
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+		ClearSlot(i);
+
+	m_iTick = -1;
+	m_iSerial++;
+	m_trackedEntities.ClearAll();
+}
+
+void CPlayerSnapshot::ClearSlot(int iSlot)
+{
+	m_nValidMask &= ~((uint64)1 << iSlot);
+	m_nViewMask &= ~((uint64)1 << iSlot);
+
+	for (int i = 0; i < 4; i++)
+		m_nTeamMask[i] &= ~((uint64)1 << iSlot);
+
+	m_pController[iSlot] = nullptr;
+	m_pPlayerPawn[iSlot] = nullptr;
+	m_pPawn[iSlot] = nullptr;
+	m_pObserverTarget[iSlot] = nullptr;
+	m_pZEPlayer[iSlot] = nullptr;
+	m_flOriginX[iSlot] = 0.0f;
+	m_flOriginY[iSlot] = 0.0f;
+	m_flOriginZ[iSlot] = 0.0f;
+	m_flViewX[iSlot] = 0.0f;
+	m_flViewY[iSlot] = 0.0f;
+	m_flViewZ[iSlot] = 0.0f;
+	m_iPawnEntIndex[iSlot] = -1;
+	m_iPawnState[iSlot] = STATE_WELCOME;
+	m_iTeamNum[iSlot] = CS_TEAM_NONE;
+	m_bAlive[iSlot] = false;
+	m_bConnected[iSlot] = false;
+	m_bIsHLTV[iSlot] = false;
+}
+
+void CPlayerSnapshot::Update()
+{
+	if (!g_pEntitySystem)
+		return;
+
+	VPROF("CPlayerSnapshot::Update");
+
+	m_iTick = gpGlobals->tickcount;
+	m_iSerial++;
+	m_trackedEntities.ClearAll();
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		ClearSlot(i);
+
+		if (i >= gpGlobals->maxClients)
+			continue;
+
+		CCSPlayerController *pController = CCSPlayerController::FromSlot(i);
+
+		if (!pController)
+			continue;
+
+		m_pController[i] = pController;
+		m_trackedEntities.Set(pController->entindex());
+		m_pZEPlayer[i] = g_playerManager->GetPlayer(i);
+		m_iTeamNum[i] = pController->m_iTeamNum();
+		m_nTeamMask[m_iTeamNum[i] & 3] |= (uint64)1 << i;
+		m_bConnected[i] = pController->IsConnected();
+		m_bIsHLTV[i] = pController->m_bIsHLTV();
+
+		CCSPlayerPawn *pPlayerPawn = pController->GetPlayerPawn();
+
+		if (pPlayerPawn)
+		{
+			m_pPlayerPawn[i] = pPlayerPawn;
+			m_trackedEntities.Set(pPlayerPawn->entindex());
+			Vector vecOrigin = pPlayerPawn->GetAbsOrigin();
+			m_flOriginX[i] = vecOrigin.x;
+			m_flOriginY[i] = vecOrigin.y;
+			m_flOriginZ[i] = vecOrigin.z;
+			m_iPawnEntIndex[i] = pPlayerPawn->entindex();
+			m_bAlive[i] = pPlayerPawn->IsAlive();
+		}
+
+		// All CS2 pawns are derived from CCSPlayerPawnBase
+		CCSPlayerPawnBase *pPawn = (CCSPlayerPawnBase *)pController->GetPawn();
+
+		if (pPawn)
+		{
+			m_pPawn[i] = pPawn;
+			m_iPawnState[i] = pPawn->m_iPlayerState();
+			m_trackedEntities.Set(pPawn->entindex());
+
+			if (pPawn->m_pObserverServices)
+				m_pObserverTarget[i] = pPawn->m_pObserverServices->m_hObserverTarget().Get();
+
+			if (m_pObserverTarget[i])
+				m_trackedEntities.Set(m_pObserverTarget[i]->entindex());
+		}
+
+		m_nValidMask |= (uint64)1 << i;
+	}
+
+	for (int i = 0; i < gpGlobals->maxClients; i++)
+	{
+		if (!IsValid(i))
+			continue;
+
+		int iViewSlot = i;
+
+		if (m_iPawnState[i] == STATE_OBSERVER_MODE)
+		{
+			iViewSlot = -1;
+
+			for (int j = 0; m_pObserverTarget[i] && j < gpGlobals->maxClients; j++)
+			{
+				if (m_pPawn[j] == m_pObserverTarget[i])
+				{
+					iViewSlot = j;
+					break;
+				}
+			}
+		}
+
+		if (iViewSlot == -1 || !m_pPlayerPawn[iViewSlot])
+			continue;
+
+		m_flViewX[i] = m_flOriginX[iViewSlot];
+		m_flViewY[i] = m_flOriginY[iViewSlot];
+		m_flViewZ[i] = m_flOriginZ[iViewSlot];
+		m_nViewMask |= (uint64)1 << i;
+	}
+}
+
+void CPlayerSnapshot::OnEntityDeleted(CEntityInstance *pEntity)
+{
+	// Almost every deleted entity is no player's, find that out from its handle before looking at any slot
+	int iEntIndex = pEntity->m_pEntity->m_EHandle.GetEntryIndex();
+
+	if (iEntIndex < 0 || iEntIndex >= m_trackedEntities.GetNumBits() || !m_trackedEntities.IsBitSet(iEntIndex))
+		return;
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		if (!IsValid(i))
+			continue;
+
+		if (m_pController[i] == pEntity || m_pPlayerPawn[i] == pEntity || m_pPawn[i] == pEntity)
+			ClearSlot(i);
+		else if (m_pObserverTarget[i] == pEntity)
+			m_pObserverTarget[i] = nullptr;
+	}
+}
@@ -0,0 +1,85 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "common.h"
+#include "mathlib/vector.h"
+#include "bitvec.h"
+
+class CCSPlayerController;
+class CCSPlayerPawn;
+class CBasePlayerPawn;
+class CBaseEntity;
+class CEntityInstance;
+class ZEPlayer;
+
+// Player state that per-frame code keeps asking for, gathered before entities think and again after
+// Loops over every player should read from here instead of going through FromSlot, pawn handles and schema accessors again
+// Slots are dropped as soon as their controller, pawn or ZEPlayer goes away, so the pointers are safe to use until the next update
+class CPlayerSnapshot
+{
+public:
+	CPlayerSnapshot() : m_iSerial(0) { Clear(); }
+
+	void Update();
+	void Clear();
+	void ClearSlot(int iSlot);
+	void OnEntityDeleted(CEntityInstance *pEntity);
+
+	bool IsValid(int iSlot) { return m_nValidMask & ((uint64)1 << iSlot); }
+	uint64 GetValidMask() { return m_nValidMask; }
+	uint64 GetTeamMask(int iTeam) { return m_nTeamMask[iTeam & 3]; }
+	Vector GetOrigin(int iSlot) { return Vector(m_flOriginX[iSlot], m_flOriginY[iSlot], m_flOriginZ[iSlot]); }
+
+	// Where a player sees and hears the world from, the pawn of whoever they're spectating or their own
+	// Not known for free roaming spectators and players without a pawn
+	bool HasViewOrigin(int iSlot) { return m_nViewMask & ((uint64)1 << iSlot); }
+	uint64 GetViewMask() { return m_nViewMask; }
+	Vector GetViewOrigin(int iSlot) { return Vector(m_flViewX[iSlot], m_flViewY[iSlot], m_flViewZ[iSlot]); }
+	int GetTick() { return m_iTick; }
+	int GetSerial() { return m_iSerial; } // Goes up with every update, there's more than one per tick
+
+	CCSPlayerController *m_pController[MAXPLAYERS];
+	CCSPlayerPawn *m_pPlayerPawn[MAXPLAYERS];	// The actual player pawn (m_hPlayerPawn)
+	CBasePlayerPawn *m_pPawn[MAXPLAYERS];		// The current pawn (m_hPawn), this is the observer pawn while spectating
+	CBaseEntity *m_pObserverTarget[MAXPLAYERS];	// Only meant for comparisons, this can be any entity
+	ZEPlayer *m_pZEPlayer[MAXPLAYERS];
+	alignas(16) float m_flOriginX[MAXPLAYERS];	// Player pawn origin, split per axis for the proximity kernels
+	alignas(16) float m_flOriginY[MAXPLAYERS];
+	alignas(16) float m_flOriginZ[MAXPLAYERS];
+	alignas(16) float m_flViewX[MAXPLAYERS];	// See GetViewOrigin
+	alignas(16) float m_flViewY[MAXPLAYERS];
+	alignas(16) float m_flViewZ[MAXPLAYERS];
+	int m_iPawnEntIndex[MAXPLAYERS];			// Player pawn entindex, -1 without a pawn
+	uint32 m_iPawnState[MAXPLAYERS];			// Same as CCSPlayerController::GetPawnState
+	uint8 m_iTeamNum[MAXPLAYERS];
+	bool m_bAlive[MAXPLAYERS];					// Player pawn is alive
+	bool m_bConnected[MAXPLAYERS];
+	bool m_bIsHLTV[MAXPLAYERS];
+
+private:
+	uint64 m_nValidMask;
+	uint64 m_nViewMask;
+	uint64 m_nTeamMask[4];
+	int m_iTick;
+	int m_iSerial;
+	CBitVec<16384> m_trackedEntities; // Entity indices any slot points to, so deleting anything else skips the slot scan
+};
+
+extern CPlayerSnapshot *g_pPlayerSnapshot;
@@ -0,0 +1,403 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "postevent.h"
+#include "utlvector.h"
+#include "networksystem/inetworkmessages.h"
+#include "playersnapshot.h"
+#include "entity/ccsplayercontroller.h"
+#include "tier0/platform.h"
+#include <google/protobuf/message.h>
+#include <bit>
+#include <ctime>
+#include <cstdio>
+
+#include "tier0/memdbgon.h"
+
+// Message IDs are small enough to index directly, the highest the game uses is in the 400s
+#define MAX_MESSAGE_ID 1024
+
+struct PostEventSlot_t
+{
+	CUtlVector<PostEventFilter_t> m_vecFilters;
+	INetworkMessageInternal *m_pEvent;	// Only kept for the name in cs2f_postevent_stats
+	uint64 m_nPosts;
+	uint64 m_nRecipients;				// Clients left after filtering, summed over every post
+	uint64 m_nFiltered;					// Clients removed by filters
+	uint64 m_nBytes;					// Serialized size times recipients
+	int m_iBandwidthIndex;				// 1-based index into the bandwidth windows, 0 until first posted
+};
+
+static PostEventSlot_t g_postEventSlots[MAX_MESSAGE_ID];
+
+static bool g_bNetworkStats = false;
+
+FAKE_BOOL_CVAR(cs2f_network_stats, "Whether to count every posted network message and its size for cs2f_postevent_stats and cs2f_bandwidth", g_bNetworkStats, false, false)
+
+// Bandwidth is kept in one second buckets over the last BANDWIDTH_WINDOW seconds, per message type and per recipient
+// Only types that actually get posted take a column, a round of ZE sees a few dozen
+#define BANDWIDTH_WINDOW 10
+#define MAX_BANDWIDTH_MESSAGES 128
+
+struct BandwidthBucket_t
+{
+	uint64 m_nMessages;
+	uint64 m_nBytes;
+};
+
+static int g_iBandwidthMessages = 0;
+static int g_iBandwidthMessageIds[MAX_BANDWIDTH_MESSAGES];
+static BandwidthBucket_t g_messageBandwidth[BANDWIDTH_WINDOW][MAX_BANDWIDTH_MESSAGES];
+static BandwidthBucket_t g_clientBandwidth[BANDWIDTH_WINDOW][MAXPLAYERS];
+static int64 g_iBandwidthSecond = 0;
+static bool g_bBandwidthMessagesFull = false;
+
+static void AdvanceBandwidthWindow()
+{
+	int64 iSecond = (int64)Plat_FloatTime();
+
+	if (iSecond == g_iBandwidthSecond)
+		return;
+
+	// Clear every bucket we skipped over, all of them if it's been a while
+	int64 iElapsed = MIN(iSecond - g_iBandwidthSecond, (int64)BANDWIDTH_WINDOW);
+
+	for (int64 i = 1; i <= iElapsed; i++)
+	{
+		int iBucket = (g_iBandwidthSecond + i) % BANDWIDTH_WINDOW;
+
+		V_memset(g_messageBandwidth[iBucket], 0, sizeof(g_messageBandwidth[iBucket]));
+		V_memset(g_clientBandwidth[iBucket], 0, sizeof(g_clientBandwidth[iBucket]));
+	}
+
+	g_iBandwidthSecond = iSecond;
+}
+
+static void RecordBandwidth(PostEventSlot_t &slot, int iMessageId, uint64 nClients, uint64 nSize)
+{
+	if (!slot.m_iBandwidthIndex)
+	{
+		if (g_iBandwidthMessages == MAX_BANDWIDTH_MESSAGES)
+		{
+			if (!g_bBandwidthMessagesFull)
+				Warning("cs2f_bandwidth: more than %d message types posted, message %d and any further new ones are not tracked\n", MAX_BANDWIDTH_MESSAGES, iMessageId);
+
+			g_bBandwidthMessagesFull = true;
+			return;
+		}
+
+		g_iBandwidthMessageIds[g_iBandwidthMessages] = iMessageId;
+		slot.m_iBandwidthIndex = ++g_iBandwidthMessages;
+	}
+
+	AdvanceBandwidthWindow();
+
+	int iBucket = g_iBandwidthSecond % BANDWIDTH_WINDOW;
+	int iRecipients = std::popcount(nClients);
+
+	BandwidthBucket_t &message = g_messageBandwidth[iBucket][slot.m_iBandwidthIndex - 1];
+	message.m_nMessages += iRecipients;
+	message.m_nBytes += nSize * iRecipients;
+
+	BandwidthBucket_t *pClients = g_clientBandwidth[iBucket];
+
+	for (; nClients; nClients &= nClients - 1)
+	{
+		BandwidthBucket_t &client = pClients[std::countr_zero(nClients)];
+		client.m_nMessages++;
+		client.m_nBytes += nSize;
+	}
+}
+
+void PostEvent_AddFilter(int iMessageId, PostEventFilter_t pfnFilter)
+{
+	if (iMessageId < 0 || iMessageId >= MAX_MESSAGE_ID)
+	{
+		Panic("PostEvent_AddFilter: message ID %d is out of range\n", iMessageId);
+		return;
+	}
+
+	g_postEventSlots[iMessageId].m_vecFilters.AddToTail(pfnFilter);
+}
+
+void PostEvent_RemoveFilter(int iMessageId, PostEventFilter_t pfnFilter)
+{
+	if (iMessageId < 0 || iMessageId >= MAX_MESSAGE_ID)
+		return;
+
+	g_postEventSlots[iMessageId].m_vecFilters.FindAndRemove(pfnFilter);
+}
+
+// The size the poster passes is often 0, our own posts always do that, so go by what the message serializes to
+static uint64 GetMessageSize(const PostEvent_t &event)
+{
+	return static_cast<const google::protobuf::Message *>(event.m_pData->AsProto())->ByteSizeLong();
+}
+
+static void DispatchCounted(PostEventSlot_t &slot, int iMessageId, PostEvent_t &event)
+{
+	int iClients = std::popcount(*event.m_pClients);
+
+	FOR_EACH_VEC(slot.m_vecFilters, i)
+		slot.m_vecFilters[i](event);
+
+	int iRecipients = std::popcount(*event.m_pClients);
+	uint64 nSize = GetMessageSize(event);
+
+	slot.m_pEvent = event.m_pEvent;
+	slot.m_nPosts++;
+	slot.m_nRecipients += iRecipients;
+	slot.m_nFiltered += iClients - iRecipients;
+	slot.m_nBytes += nSize * iRecipients;
+
+	RecordBandwidth(slot, iMessageId, *event.m_pClients, nSize);
+}
+
+void PostEvent_Dispatch(PostEvent_t &event)
+{
+	int iMessageId = event.m_pEvent->GetNetMessageInfo()->m_MessageId;
+
+	if (iMessageId < 0 || iMessageId >= MAX_MESSAGE_ID)
+		return;
+
+	PostEventSlot_t &slot = g_postEventSlots[iMessageId];
+
+	if (g_bNetworkStats)
+	{
+		DispatchCounted(slot, iMessageId, event);
+		return;
+	}
+
+	// Nearly every message has no filters, those go straight back to the engine
+	if (slot.m_vecFilters.Count() == 0)
+		return;
+
+	FOR_EACH_VEC(slot.m_vecFilters, i)
+		slot.m_vecFilters[i](event);
+}
+
+void PostEvent_RecordRepost(const PostEvent_t &event, uint64 nClients)
+{
+	if (!g_bNetworkStats)
+		return;
+
+	int iMessageId = event.m_pEvent->GetNetMessageInfo()->m_MessageId;
+
+	if (iMessageId < 0 || iMessageId >= MAX_MESSAGE_ID)
+		return;
+
+	RecordBandwidth(g_postEventSlots[iMessageId], iMessageId, nClients, GetMessageSize(event));
+}
+
+// Sums the finished seconds of the window, the one in progress would drag the averages down
+static void SumBandwidth(BandwidthBucket_t *pMessages, BandwidthBucket_t *pClients)
+{
+	AdvanceBandwidthWindow();
+
+	V_memset(pMessages, 0, sizeof(BandwidthBucket_t) * MAX_BANDWIDTH_MESSAGES);
+	V_memset(pClients, 0, sizeof(BandwidthBucket_t) * MAXPLAYERS);
+
+	int iCurrent = g_iBandwidthSecond % BANDWIDTH_WINDOW;
+
+	for (int iBucket = 0; iBucket < BANDWIDTH_WINDOW; iBucket++)
+	{
+		if (iBucket == iCurrent)
+			continue;
+
+		for (int i = 0; i < g_iBandwidthMessages; i++)
+		{
+			pMessages[i].m_nMessages += g_messageBandwidth[iBucket][i].m_nMessages;
+			pMessages[i].m_nBytes += g_messageBandwidth[iBucket][i].m_nBytes;
+		}
+
+		for (int i = 0; i < MAXPLAYERS; i++)
+		{
+			pClients[i].m_nMessages += g_clientBandwidth[iBucket][i].m_nMessages;
+			pClients[i].m_nBytes += g_clientBandwidth[iBucket][i].m_nBytes;
+		}
+	}
+}
+
+static const char *GetBandwidthMessageName(int iIndex)
+{
+	INetworkMessageInternal *pEvent = g_postEventSlots[g_iBandwidthMessageIds[iIndex]].m_pEvent;
+	return pEvent ? pEvent->GetUnscopedName() : "unknown";
+}
+
+static const char *GetBandwidthClientName(int iSlot)
+{
+	if (!g_pPlayerSnapshot || !g_pPlayerSnapshot->IsValid(iSlot))
+		return "disconnected";
+
+	return g_pPlayerSnapshot->m_pController[iSlot]->GetPlayerName();
+}
+
+static BandwidthBucket_t *g_pSortBuckets = nullptr;
+
+static int CompareBucketBytes(const int *a, const int *b)
+{
+	uint64 nBytesA = g_pSortBuckets[*a].m_nBytes;
+	uint64 nBytesB = g_pSortBuckets[*b].m_nBytes;
+
+	return nBytesA < nBytesB ? 1 : nBytesA > nBytesB ? -1 : 0;
+}
+
+static void SortBucketsByBytes(BandwidthBucket_t *pBuckets, int iCount, CUtlVector<int> &vecOrder)
+{
+	for (int i = 0; i < iCount; i++)
+	{
+		if (pBuckets[i].m_nMessages)
+			vecOrder.AddToTail(i);
+	}
+
+	g_pSortBuckets = pBuckets;
+	vecOrder.Sort(CompareBucketBytes);
+}
+
+CON_COMMAND_F(cs2f_bandwidth, "Print the biggest outbound message types and recipients per second over the last 10 seconds, usage: cs2f_bandwidth [count]", FCVAR_LINKED_CONCOMMAND | FCVAR_SPONLY)
+{
+	if (!g_bNetworkStats)
+		Message("cs2f_bandwidth: cs2f_network_stats is off, nothing new is being recorded\n");
+
+	int iTop = args.ArgC() < 2 ? 10 : V_StringToInt32(args[1], 10);
+
+	BandwidthBucket_t messages[MAX_BANDWIDTH_MESSAGES];
+	BandwidthBucket_t clients[MAXPLAYERS];
+	SumBandwidth(messages, clients);
+
+	const float flSeconds = BANDWIDTH_WINDOW - 1;
+	CUtlVector<int> vecMessages, vecClients;
+	SortBucketsByBytes(messages, g_iBandwidthMessages, vecMessages);
+	SortBucketsByBytes(clients, MAXPLAYERS, vecClients);
+
+	Message("Top message types, per second:\n");
+	Message("  %-6s %-36s %12s %12s\n", "id", "message", "sent", "bytes");
+
+	for (int i = 0; i < vecMessages.Count() && i < iTop; i++)
+	{
+		BandwidthBucket_t &bucket = messages[vecMessages[i]];
+		Message("  %-6d %-36s %12.1f %12.1f\n", g_iBandwidthMessageIds[vecMessages[i]], GetBandwidthMessageName(vecMessages[i]),
+			bucket.m_nMessages / flSeconds, bucket.m_nBytes / flSeconds);
+	}
+
+	Message("Top recipients, per second:\n");
+	Message("  %-6s %-36s %12s %12s\n", "slot", "player", "received", "bytes");
+
+	for (int i = 0; i < vecClients.Count() && i < iTop; i++)
+	{
+		BandwidthBucket_t &bucket = clients[vecClients[i]];
+		Message("  %-6d %-36s %12.1f %12.1f\n", vecClients[i], GetBandwidthClientName(vecClients[i]),
+			bucket.m_nMessages / flSeconds, bucket.m_nBytes / flSeconds);
+	}
+}
+
+static bool g_bDumpBandwidthToFile = false;
+
+FAKE_BOOL_CVAR(cs2f_bandwidth_dump_file, "Whether to append per message and per client bandwidth to data/bandwidth.csv every minute", g_bDumpBandwidthToFile, false, false)
+
+void PostEvent_DumpBandwidthToFile()
+{
+	if (!g_bDumpBandwidthToFile || !g_bNetworkStats)
+		return;
+
+	char szPath[MAX_PATH];
+	V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), "/csgo/addons/cs2fixes/data/bandwidth.csv");
+
+	FILE *pFile = fopen(szPath, "a");
+
+	if (!pFile)
+		return;
+
+	// Header only for a new file
+	fseek(pFile, 0, SEEK_END);
+
+	if (ftell(pFile) == 0)
+		fprintf(pFile, "time,kind,id,name,sent_per_sec,bytes_per_sec\n");
+
+	BandwidthBucket_t messages[MAX_BANDWIDTH_MESSAGES];
+	BandwidthBucket_t clients[MAXPLAYERS];
+	SumBandwidth(messages, clients);
+
+	const float flSeconds = BANDWIDTH_WINDOW - 1;
+	char szTime[64];
+	time_t now = time(nullptr);
+	strftime(szTime, sizeof(szTime), "%Y-%m-%d %H:%M:%S", localtime(&now));
+
+	for (int i = 0; i < g_iBandwidthMessages; i++)
+	{
+		if (messages[i].m_nMessages)
+			fprintf(pFile, "%s,message,%d,%s,%.1f,%.1f\n", szTime, g_iBandwidthMessageIds[i], GetBandwidthMessageName(i),
+				messages[i].m_nMessages / flSeconds, messages[i].m_nBytes / flSeconds);
+	}
+
+	// Player names can contain anything, so they're left out here and the slot is enough to line up with status
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		if (clients[i].m_nMessages)
+			fprintf(pFile, "%s,client,%d,,%.1f,%.1f\n", szTime, i, clients[i].m_nMessages / flSeconds, clients[i].m_nBytes / flSeconds);
+	}
+
+	fclose(pFile);
+}
+
+static int CompareSlotPosts(const int *a, const int *b)
+{
+	uint64 nPostsA = g_postEventSlots[*a].m_nPosts;
+	uint64 nPostsB = g_postEventSlots[*b].m_nPosts;
+
+	return nPostsA < nPostsB ? 1 : nPostsA > nPostsB ? -1 : 0;
+}
+
+CON_COMMAND_F(cs2f_postevent_stats, "Print how often each network message was posted and how many clients filters removed, usage: cs2f_postevent_stats [reset]", FCVAR_LINKED_CONCOMMAND | FCVAR_SPONLY)
+{
+	if (args.ArgC() > 1 && !V_stricmp(args[1], "reset"))
+	{
+		for (int i = 0; i < MAX_MESSAGE_ID; i++)
+		{
+			PostEventSlot_t &slot = g_postEventSlots[i];
+			slot.m_nPosts = slot.m_nRecipients = slot.m_nFiltered = slot.m_nBytes = 0;
+		}
+
+		Message("cs2f_postevent_stats: counters reset\n");
+		return;
+	}
+
+	if (!g_bNetworkStats)
+		Message("cs2f_postevent_stats: cs2f_network_stats is off, nothing new is being counted\n");
+
+	CUtlVector<int> vecIds;
+
+	for (int i = 0; i < MAX_MESSAGE_ID; i++)
+	{
+		if (g_postEventSlots[i].m_nPosts)
+			vecIds.AddToTail(i);
+	}
+
+	vecIds.Sort(CompareSlotPosts);
+
+	Message("%-6s %-36s %10s %12s %12s %14s %8s\n", "id", "message", "posts", "recipients", "filtered", "bytes", "filters");
+
+	FOR_EACH_VEC(vecIds, i)
+	{
+		PostEventSlot_t &slot = g_postEventSlots[vecIds[i]];
+
+		Message("%-6d %-36s %10llu %12llu %12llu %14llu %8d\n", vecIds[i], slot.m_pEvent->GetUnscopedName(),
+			slot.m_nPosts, slot.m_nRecipients, slot.m_nFiltered, slot.m_nBytes, slot.m_vecFilters.Count());
+	}
+}
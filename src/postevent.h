@@ -0,0 +1,51 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "common.h"
+#include "engine/igameeventsystem.h"
+
+// Everything a PostEventAbstract call carries, filters narrow down m_pClients or repost the event themselves
+struct PostEvent_t
+{
+	CSplitScreenSlot m_nSlot;
+	bool m_bLocalOnly;
+	int m_nClientCount;
+	uint64 *m_pClients;
+	INetworkMessageInternal *m_pEvent;
+	const CNetMessage *m_pData;
+	unsigned long m_nSize;
+	NetChannelBufType_t m_bufType;
+};
+
+typedef void (*PostEventFilter_t)(PostEvent_t &event);
+
+// Filters run in the order they were added every time a message with this ID is posted
+void PostEvent_AddFilter(int iMessageId, PostEventFilter_t pfnFilter);
+void PostEvent_RemoveFilter(int iMessageId, PostEventFilter_t pfnFilter);
+
+// Runs the filters for the event's message ID, messages without filters return right away
+// With cs2f_network_stats on, every message is also counted for cs2f_postevent_stats and cs2f_bandwidth
+void PostEvent_Dispatch(PostEvent_t &event);
+
+// For events filters post themselves, those skip our hook so they'd be missing from the bandwidth numbers
+void PostEvent_RecordRepost(const PostEvent_t &event, uint64 nClients);
+
+// Appends the rolling per-second bandwidth by message and by client to data/bandwidth.csv, if cs2f_bandwidth_dump_file and cs2f_network_stats are on
+void PostEvent_DumpBandwidthToFile();
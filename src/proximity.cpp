@@ -0,0 +1,138 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "proximity.h"
+#include "tier0/platform.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROXIMITY_SSE
+#include <emmintrin.h>
+#endif
+
+#include "tier0/memdbgon.h"
+
+static uint64 QueryScalar(const float *pX, const float *pY, const float *pZ, int iStart, int iCount, const Vector &vecOrigin, float flRadiusSqr)
+{
+	uint64 nResult = 0;
+
+	for (int i = iStart; i < iCount; i++)
+	{
+		float dx = pX[i] - vecOrigin.x;
+		float dy = pY[i] - vecOrigin.y;
+		float dz = pZ[i] - vecOrigin.z;
+
+		if (dx * dx + dy * dy + dz * dz <= flRadiusSqr)
+			nResult |= (uint64)1 << i;
+	}
+
+	return nResult;
+}
+
+uint64 Proximity_Query(const float *pX, const float *pY, const float *pZ, int iCount, const Vector &vecOrigin, float flRadius, uint64 nCandidates)
+{
+	iCount = MIN(iCount, 64);
+	float flRadiusSqr = flRadius * flRadius;
+
+#ifdef PROXIMITY_SSE
+	__m128 x = _mm_set1_ps(vecOrigin.x);
+	__m128 y = _mm_set1_ps(vecOrigin.y);
+	__m128 z = _mm_set1_ps(vecOrigin.z);
+	__m128 radiusSqr = _mm_set1_ps(flRadiusSqr);
+
+	uint64 nResult = 0;
+	int i = 0;
+
+	for (; i + 4 <= iCount; i += 4)
+	{
+		if (!((nCandidates >> i) & 0xF))
+			continue;
+
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(pX + i), x);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(pY + i), y);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(pZ + i), z);
+		__m128 distSqr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		nResult |= (uint64)_mm_movemask_ps(_mm_cmple_ps(distSqr, radiusSqr)) << i;
+	}
+
+	if (i < iCount)
+		nResult |= QueryScalar(pX, pY, pZ, i, iCount, vecOrigin, flRadiusSqr);
+
+	return nResult & nCandidates;
+#else
+	return QueryScalar(pX, pY, pZ, 0, iCount, vecOrigin, flRadiusSqr) & nCandidates;
+#endif
+}
+
+CON_COMMAND_F(cs2f_bench_proximity, "Time a full 64x64 proximity evaluation with the scalar and vectorized kernels, usage: cs2f_bench_proximity [iterations]", FCVAR_LINKED_CONCOMMAND | FCVAR_SPONLY)
+{
+	int iIterations = args.ArgC() < 2 ? 10000 : V_StringToInt32(args[1], 10000);
+
+	if (iIterations < 1)
+		iIterations = 1;
+
+	// Fixed seed so runs are comparable, players spread over a 4096 unit square with hide distances up to 1000
+	uint32 iSeed = 12345;
+	auto Random = [&iSeed](uint32 iMax) { iSeed = iSeed * 1664525 + 1013904223; return (iSeed >> 8) % iMax; };
+
+	alignas(16) float flX[MAXPLAYERS], flY[MAXPLAYERS], flZ[MAXPLAYERS], flRadii[MAXPLAYERS];
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		flX[i] = (float)Random(4096) - 2048.0f;
+		flY[i] = (float)Random(4096) - 2048.0f;
+		flZ[i] = (float)Random(512);
+		flRadii[i] = (float)Random(1000);
+	}
+
+	uint64 nScalarResults[MAXPLAYERS], nResults[MAXPLAYERS];
+	uint64 nChecksum = 0;
+
+	double flStart = Plat_FloatTime();
+
+	for (int iIteration = 0; iIteration < iIterations; iIteration++)
+	{
+		for (int i = 0; i < MAXPLAYERS; i++)
+			nScalarResults[i] = QueryScalar(flX, flY, flZ, 0, MAXPLAYERS, Vector(flX[i], flY[i], flZ[i]), flRadii[i] * flRadii[i]);
+
+		nChecksum += nScalarResults[iIteration & (MAXPLAYERS - 1)];
+	}
+
+	double flScalarTime = Plat_FloatTime() - flStart;
+	flStart = Plat_FloatTime();
+
+	for (int iIteration = 0; iIteration < iIterations; iIteration++)
+	{
+		for (int i = 0; i < MAXPLAYERS; i++)
+			nResults[i] = Proximity_Query(flX, flY, flZ, MAXPLAYERS, Vector(flX[i], flY[i], flZ[i]), flRadii[i]);
+
+		nChecksum += nResults[iIteration & (MAXPLAYERS - 1)];
+	}
+
+	double flKernelTime = Plat_FloatTime() - flStart;
+	bool bMatch = !V_memcmp(nScalarResults, nResults, sizeof(nResults));
+
+	Message("cs2f_bench_proximity: %d iterations, results %s (checksum %llu)\n", iIterations, bMatch ? "match" : "DIFFER", nChecksum);
+	Message("  scalar: %.1f ns per 64x64\n", flScalarTime * 1000000000.0 / iIterations);
+#ifdef PROXIMITY_SSE
+	Message("  SSE:    %.1f ns per 64x64 (%.1fx)\n", flKernelTime * 1000000000.0 / iIterations, flKernelTime > 0.0 ? flScalarTime / flKernelTime : 0.0);
+#else
+	Message("  kernel: %.1f ns per 64x64 (built without SSE, this is the scalar fallback)\n", flKernelTime * 1000000000.0 / iIterations);
+#endif
+}
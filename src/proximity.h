@@ -0,0 +1,29 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "common.h"
+#include "mathlib/vector.h"
+
+// "Which of these points are within R of X" over positions split per axis (see the origin columns in CPlayerSnapshot)
+// Up to 64 points, bit i of the result is set when point i is in range, uses SSE2 when available
+// nCandidates limits which points are tested, groups of 4 without any candidates are skipped entirely
+// SSE2 is the baseline of every x86_64 build, anything wider would need a CPU check and a second kernel to save about a microsecond per
+// full 64x64 evaluation, while the sparse candidate masks the callers pass skip more work in groups of 4 than they would in 8
+uint64 Proximity_Query(const float *pX, const float *pY, const float *pZ, int iCount, const Vector &vecOrigin, float flRadius, uint64 nCandidates = ~(uint64)0);
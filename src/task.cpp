@@ -0,0 +1,137 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "task.h"
+#include <exception>
+
+void Panic(const char *, ...);
+
+// Coroutine frames are pooled by size class, frames of the same function are always the same size so they recycle well
+static constexpr size_t TASK_FRAME_SIZES[] = { 256, 512, 1024, 2048 };
+static constexpr int TASK_FRAME_CLASSES = sizeof(TASK_FRAME_SIZES) / sizeof(TASK_FRAME_SIZES[0]);
+
+struct TaskFrame_t
+{
+    TaskFrame_t *m_pNextFree;
+};
+
+static TaskFrame_t *g_pFreeTaskFrames[TASK_FRAME_CLASSES] = {};
+static int g_iLiveTasks = 0;
+
+static int GetTaskFrameClass(size_t nSize)
+{
+    for (int i = 0; i < TASK_FRAME_CLASSES; i++)
+    {
+        if (nSize <= TASK_FRAME_SIZES[i])
+            return i;
+    }
+
+    return -1;
+}
+
+void *CTask::promise_type::operator new(size_t nSize)
+{
+    g_iLiveTasks++;
+
+    int iClass = GetTaskFrameClass(nSize);
+
+    if (iClass == -1)
+        return ::operator new(nSize);
+
+    TaskFrame_t *pFrame = g_pFreeTaskFrames[iClass];
+
+    if (!pFrame)
+        return ::operator new(TASK_FRAME_SIZES[iClass]);
+
+    g_pFreeTaskFrames[iClass] = pFrame->m_pNextFree;
+
+    return pFrame;
+}
+
+void CTask::promise_type::operator delete(void *pMem, size_t nSize)
+{
+    g_iLiveTasks--;
+
+    int iClass = GetTaskFrameClass(nSize);
+
+    if (iClass == -1)
+    {
+        ::operator delete(pMem);
+        return;
+    }
+
+    TaskFrame_t *pFrame = (TaskFrame_t *)pMem;
+    pFrame->m_pNextFree = g_pFreeTaskFrames[iClass];
+    g_pFreeTaskFrames[iClass] = pFrame;
+}
+
+void CTask::promise_type::unhandled_exception()
+{
+    Panic("Unhandled exception in a task\n");
+    std::terminate();
+}
+
+void Seconds::await_suspend(std::coroutine_handle<> hTask)
+{
+    new CTimer(m_flSeconds, false, m_bPreserveRoundChange, m_owner, [resumer = CTaskResumer(hTask)]() mutable
+    {
+        resumer.Resume();
+        return -1.0f;
+    }, m_location);
+}
+
+void NextTick::await_suspend(std::coroutine_handle<> hTask)
+{
+    RunNextTick([resumer = CTaskResumer(hTask)]() mutable
+    {
+        resumer.Resume();
+    });
+}
+
+static CUtlVector<std::coroutine_handle<>> g_roundEndTasks;
+
+void RoundEnd::await_suspend(std::coroutine_handle<> hTask)
+{
+    g_roundEndTasks.AddToTail(hTask);
+}
+
+void ResumeRoundEndTasks()
+{
+    // Resumed tasks may well wait for the next round end, so resume from a copy
+    static CUtlVector<std::coroutine_handle<>> s_vecResume;
+    s_vecResume.Swap(g_roundEndTasks);
+
+    FOR_EACH_VEC(s_vecResume, i)
+        s_vecResume[i].resume();
+
+    s_vecResume.RemoveAll();
+}
+
+void RemoveMapTasks()
+{
+    FOR_EACH_VEC(g_roundEndTasks, i)
+        g_roundEndTasks[i].destroy();
+
+    g_roundEndTasks.RemoveAll();
+}
+
+int GetLiveTaskCount()
+{
+    return g_iLiveTasks;
+}
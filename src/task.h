@@ -0,0 +1,116 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <coroutine>
+#include "ctimer.h"
+
+// Fire and forget coroutine for multi-step flows that would otherwise be a chain of timers, e.g.
+//
+//     CTask Countdown()
+//     {
+//         for (int i = 3; i > 0; i--)
+//         {
+//             ClientPrintAll(HUD_PRINTTALK, "%i", i);
+//             co_await Seconds(1.0f);
+//         }
+//     }
+//
+// The task starts running as soon as it's called and its frame comes out of a pool. Whatever the task is waiting on owns
+// the suspended frame, so a task waiting on a timer that gets removed (map change, round change, owner cancelled) is destroyed
+// along with it and never resumes. Always capture handles rather than pointers in tasks, same as with timers.
+class CTask
+{
+public:
+    struct promise_type
+    {
+        CTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception();
+
+        static void *operator new(size_t nSize);
+        static void operator delete(void *pMem, size_t nSize);
+    };
+};
+
+// Owns a suspended task and destroys it unless it gets resumed first
+class CTaskResumer
+{
+public:
+    CTaskResumer(std::coroutine_handle<> hTask) : m_hTask(hTask) {}
+    CTaskResumer(CTaskResumer &&other) : m_hTask(other.m_hTask) { other.m_hTask = nullptr; }
+
+    ~CTaskResumer()
+    {
+        if (m_hTask)
+            m_hTask.destroy();
+    }
+
+    CTaskResumer(const CTaskResumer &) = delete;
+    CTaskResumer &operator=(const CTaskResumer &) = delete;
+
+    void Resume()
+    {
+        std::coroutine_handle<> hTask = m_hTask;
+        m_hTask = nullptr;
+        hTask.resume();
+    }
+
+private:
+    std::coroutine_handle<> m_hTask;
+};
+
+// Resume after a number of seconds, this works just like a CTimer with the same settings
+struct Seconds
+{
+    Seconds(float flSeconds, bool bPreserveRoundChange = false, TimerOwner_t owner = TimerOwner_t(),
+        const std::source_location &location = std::source_location::current()) :
+        m_flSeconds(flSeconds), m_bPreserveRoundChange(bPreserveRoundChange), m_owner(owner), m_location(location) {}
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> hTask);
+    void await_resume() {}
+
+    float m_flSeconds;
+    bool m_bPreserveRoundChange;
+    TimerOwner_t m_owner;
+    std::source_location m_location;
+};
+
+// Resume on the next deferred call drain, see RunNextTick, the task is dropped if the round changes first
+struct NextTick
+{
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> hTask);
+    void await_resume() {}
+};
+
+// Resume when the current round ends, the task is dropped on map change
+struct RoundEnd
+{
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> hTask);
+    void await_resume() {}
+};
+
+void ResumeRoundEndTasks();
+void RemoveMapTasks();
+int GetLiveTaskCount();
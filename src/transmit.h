@@ -0,0 +1,56 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "common.h"
+#include "bitvec.h"
+
+class CEntityInstance;
+
+// Everything Hook_CheckTransmit needs about players, gathered once per call instead of once per client pair
+// Masks are indexed by player slot, HLTV clients are never part of them
+struct TransmitPlayers_t
+{
+	uint64 m_nFlashLightMask;				// Players with a flashlight, only spectators watching them get to see it
+	uint64 m_nHideableMask;					// Players with a pawn that can be hidden, leaders are always transmitted
+	uint64 m_nDeadMask;						// Players with a dead pawn, these are hidden from everyone
+	uint64 m_nObserverMask;					// Clients currently spectating
+	uint64 m_nBlockMask[MAXPLAYERS];		// Players each client has hidden
+	uint64 m_nWatchedMask[MAXPLAYERS];		// Players each spectating client is watching
+	int m_iPawnEntIndex[MAXPLAYERS];
+	int m_iFlashLightEntIndex[MAXPLAYERS];
+};
+
+void Transmit_BuildPlayers(TransmitPlayers_t &players);
+
+// Removes the player pawns and flashlights a client shouldn't see from its transmit list
+void Transmit_HidePlayers(const TransmitPlayers_t &players, int iSlot, CBitVec<16384> &transmitEntities, bool bHideFlashLights, bool bHidePlayers);
+
+// Distance culling for the classnames listed in cs2f_transmit_lod, entities are tracked from when they spawn
+void Transmit_OnEntitySpawned(CEntityInstance *pEntity);
+void Transmit_OnEntityDeleted(CEntityInstance *pEntity);
+
+// Forgets every tracked entity, called from Hook_StartupServer so nothing from the previous map is ever looked at
+void Transmit_OnMapChange();
+
+// Gathers the positions of tracked entities, once per CheckTransmit
+void Transmit_BuildLOD();
+
+// Removes tracked entities too far from the client's view origin, either its own pawn or the player it's spectating
+void Transmit_CullDistant(int iSlot, CBitVec<16384> &transmitEntities);
@@ -0,0 +1,186 @@
+/**
+* =============================================================================
+* CS2Fixes
+* Copyright (C) 2023-2024 Source2ZE
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "module.h"
+
+#include <algorithm>
+#include <bit>
+#include <emmintrin.h>
+
+#include "tier0/memdbgon.h"
+
+#define SIG_WILDCARD 0x2A
+
+// The executable sections are walked in blocks this big, so every anchor byte gets searched while the block is still cached
+#define SCAN_BLOCK_SIZE 0x10000
+
+// How common each byte is only needs to be roughly right, so only every this many bytes are counted
+#define SCAN_SAMPLE_STRIDE 61
+
+struct ScanRegion_t
+{
+	const byte *m_pBase;
+	size_t m_iSize;
+};
+
+static bool MatchesSignature(const byte *pMemory, const SignatureScan_t &scan)
+{
+	for (size_t i = 0; i < scan.m_iLength; i++)
+	{
+		if (pMemory[i] != scan.m_pSignature[i] && scan.m_pSignature[i] != SIG_WILDCARD)
+			return false;
+	}
+
+	return true;
+}
+
+void *CModule::FindSignature(const byte *pData, size_t iSigLength, int &error)
+{
+	SignatureScan_t scan = { pData, iSigLength, nullptr, SIG_OK };
+	FindSignatures(&scan, 1);
+
+	error = scan.m_iError;
+	return scan.m_pAddress;
+}
+
+void CModule::FindSignatures(SignatureScan_t *pScans, int iCount)
+{
+	std::vector<ScanRegion_t> regions;
+
+	for (auto &section : m_sections)
+	{
+		if (section.m_bExecutable && section.m_iSize > 0)
+			regions.push_back({ (const byte *)section.m_pBase, section.m_iSize });
+	}
+
+	// No section info to go by, so fall back to the whole image
+	if (regions.empty())
+		regions.push_back({ (const byte *)m_base, m_size });
+
+	size_t byteCounts[256] = {};
+
+	for (auto &region : regions)
+	{
+		for (size_t i = 0; i < region.m_iSize; i += SCAN_SAMPLE_STRIDE)
+			byteCounts[region.m_pBase[i]]++;
+	}
+
+	// Every signature is anchored on its rarest non-wildcard byte, signatures sharing an anchor are chained together
+	std::vector<size_t> anchorOffsets(iCount, 0);
+	std::vector<int> nextScan(iCount, -1);
+	std::vector<byte> anchors;
+	int firstScan[256];
+	int iRemaining = 0;
+
+	std::fill(std::begin(firstScan), std::end(firstScan), -1);
+
+	for (int i = 0; i < iCount; i++)
+	{
+		SignatureScan_t &scan = pScans[i];
+		scan.m_pAddress = nullptr;
+		scan.m_iError = SIG_NOT_FOUND;
+
+		int iAnchor = -1;
+
+		for (size_t j = 0; j < scan.m_iLength; j++)
+		{
+			byte value = scan.m_pSignature[j];
+
+			if (value != SIG_WILDCARD && (iAnchor == -1 || byteCounts[value] < byteCounts[scan.m_pSignature[iAnchor]]))
+				iAnchor = j;
+		}
+
+		// Nothing but wildcards, there is nothing to look for
+		if (iAnchor == -1)
+			continue;
+
+		byte anchor = scan.m_pSignature[iAnchor];
+
+		if (firstScan[anchor] == -1)
+			anchors.push_back(anchor);
+
+		anchorOffsets[i] = iAnchor;
+		nextScan[i] = firstScan[anchor];
+		firstScan[anchor] = i;
+		iRemaining++;
+	}
+
+	// Checks every signature anchored on the byte at iPos, a signature found twice is done and gets unlinked
+	auto CheckCandidate = [&](const ScanRegion_t &region, size_t iPos, byte anchor)
+	{
+		int *pLink = &firstScan[anchor];
+
+		while (*pLink != -1)
+		{
+			int iScan = *pLink;
+			SignatureScan_t &scan = pScans[iScan];
+			size_t iOffset = anchorOffsets[iScan];
+
+			if (iPos >= iOffset && iPos - iOffset + scan.m_iLength <= region.m_iSize && MatchesSignature(region.m_pBase + iPos - iOffset, scan))
+			{
+				if (scan.m_pAddress)
+				{
+					scan.m_iError = SIG_FOUND_MULTIPLE;
+					*pLink = nextScan[iScan];
+					iRemaining--;
+					continue;
+				}
+
+				scan.m_pAddress = (void *)(region.m_pBase + iPos - iOffset);
+				scan.m_iError = SIG_OK;
+			}
+
+			pLink = &nextScan[iScan];
+		}
+	};
+
+	for (auto &region : regions)
+	{
+		for (size_t iBlock = 0; iBlock < region.m_iSize && iRemaining > 0; iBlock += SCAN_BLOCK_SIZE)
+		{
+			size_t iBlockEnd = std::min(iBlock + SCAN_BLOCK_SIZE, region.m_iSize);
+
+			for (byte anchor : anchors)
+			{
+				if (firstScan[anchor] == -1)
+					continue;
+
+				__m128i needle = _mm_set1_epi8((char)anchor);
+				size_t i = iBlock;
+
+				for (; i + 16 <= iBlockEnd; i += 16)
+				{
+					unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(region.m_pBase + i)), needle));
+
+					while (mask)
+					{
+						CheckCandidate(region, i + std::countr_zero(mask), anchor);
+						mask &= mask - 1;
+					}
+				}
+
+				for (; i < iBlockEnd; i++)
+				{
+					if (region.m_pBase[i] == anchor)
+						CheckCandidate(region, i, anchor);
+				}
+			}
+		}
+	}
+}
@@ -39,6 +39,15 @@ enum SigError
 	SIG_FOUND_MULTIPLE,
 };
 
+// One signature for CModule::FindSignatures, which fills in the first match and the error
+struct SignatureScan_t
+{
+	const byte *m_pSignature;
+	size_t m_iLength;
+	void *m_pAddress;
+	int m_iError;
+};
+
 // equivalent to FindSignature, but allows for multiple signatures to be found and iterated over
 class SignatureIterator
 {
@@ -108,39 +117,8 @@ public:
 		Message("Initialized module %s base: 0x%p | size: %d\n", m_pszModule, m_base, m_size);
 	}
 
-	void *FindSignature(const byte *pData, size_t iSigLength, int &error)
-	{
-		unsigned char *pMemory;
-		void *return_addr = nullptr;
-		error = 0;
-
-		pMemory = (byte*)m_base;
-
-		for (size_t i = 0; i < m_size; i++)
-		{
-			size_t Matches = 0;
-			while (*(pMemory + i + Matches) == pData[Matches] || pData[Matches] == '\x2A')
-			{
-				Matches++;
-				if (Matches == iSigLength)
-				{
-					if (return_addr)
-					{
-						error = SIG_FOUND_MULTIPLE;
-						return return_addr;
-					}
-
-					return_addr = (void *)(pMemory + i);
-					break;
-				}
-			}
-		}
-
-		if (!return_addr)
-			error = SIG_NOT_FOUND;
-
-		return return_addr;
-	}
+	void *FindSignature(const byte *pData, size_t iSigLength, int &error);
+	void FindSignatures(SignatureScan_t *pScans, int iCount);
 
 	void *FindInterface(const char *name)
 	{
@@ -28,6 +28,7 @@ struct Section
 	std::string m_szName;
 	void* m_pBase;
 	size_t m_iSize;
+	bool m_bExecutable;
 };
 
 #if defined(_WIN32)
@@ -44,6 +44,7 @@ void CModule::InitializeSections()
 		section.m_szName = (char*)pSectionHeader[i].Name;
 		section.m_pBase = (void*)((uint8_t*)m_base + pSectionHeader[i].VirtualAddress);
 		section.m_iSize = pSectionHeader[i].SizeOfRawData;
+		section.m_bExecutable = (pSectionHeader[i].Characteristics & IMAGE_SCN_MEM_EXECUTE) != 0;
 
 		m_sections.push_back(std::move(section));
 	}
@@ -21,6 +21,7 @@
 #include "commands.h"
 #include "playermanager.h"
 #include "ctimer.h"
+#include "jobscheduler.h"
 #include "icvar.h"
 #include "entity/cgamerules.h"
 #include "panoramavote.h"
@@ -88,7 +89,7 @@ void VoteManager_Init()
 		}
 	);
 
-	new CTimer(flExtendVoteTickrate, false, true, TimerCheckTimeleft);
+	g_pJobScheduler->AddJob("CheckTimeleft", flExtendVoteTickrate, false, TimerCheckTimeleft);
 }
 
 int iVoteStartTicks = 3;
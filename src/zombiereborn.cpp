@@ -23,6 +23,8 @@
 #include "utils/entity.h"
 #include "playermanager.h"
 #include "ctimer.h"
+#include "task.h"
+#include "framebudget.h"
 #include "eventlistener.h"
 #include "zombiereborn.h"
 #include "entity/cgamerules.h"
@@ -36,6 +38,7 @@
 #include "user_preferences.h"
 #include "customio.h"
 #include <sstream>
+#include <span>
 #include "leader.h"
 #include "tier0/vprof.h"
 #include <fstream>
@@ -686,12 +689,11 @@ void CZRPlayerClassManager::ApplyHumanClass(ZRHumanClass *pClass, CCSPlayerPawn
 	{
 		CHandle<CCSPlayerPawn> hPawn = pPawn->GetHandle();
 
-		new CTimer(0.02f, false, false, [hPawn]()
+		RunInTicks(2, [hPawn]()
 		{
 			CCSPlayerPawn *pPawn = hPawn.Get();
 			if (pPawn)
 				Leader_ApplyLeaderVisuals(pPawn);
-			return -1.0f;
 		});
 	}
 }
@@ -849,6 +851,7 @@ void CZRRegenTimer::Tick()
 		return;
 
 	VPROF("CZRRegenTimer::Tick");
+	FRAME_PROBE("CZRRegenTimer::Tick");
 
 	s_flNextExecution = g_flUniversalTime + 0.1f;
 	for (int i = MAXPLAYERS - 1; i >= 0; i--)
@@ -1202,22 +1205,23 @@ void ZR_InfectShake(CCSPlayerController *pController)
 	delete data;
 }
 
-std::vector<SpawnPoint*> ZR_GetSpawns()
+// Copied on every call, spawn points can be removed and replaced at any time and this is only a few dozen pointers
+// The buffer is reused though, so the span is only good until the next call
+std::span<SpawnPoint*> ZR_GetSpawns()
 {
+	static CUtlVector<SpawnPoint*> s_vecSpawns;
+
 	CUtlVector<SpawnPoint*>* ctSpawns = g_pGameRules->m_CTSpawnPoints();
 	CUtlVector<SpawnPoint*>* tSpawns = g_pGameRules->m_TerroristSpawnPoints();
-	std::vector<SpawnPoint*> spawns;
-
-	FOR_EACH_VEC(*ctSpawns, i)
-		spawns.push_back((*ctSpawns)[i]);
 
-	FOR_EACH_VEC(*tSpawns, i)
-		spawns.push_back((*tSpawns)[i]);
+	s_vecSpawns.RemoveAll();
+	s_vecSpawns.AddVectorToTail(*ctSpawns);
+	s_vecSpawns.AddVectorToTail(*tSpawns);
 
-	if (!spawns.size())
+	if (!s_vecSpawns.Count())
 		Panic("There are no spawns!\n");
 
-	return spawns;
+	return std::span<SpawnPoint*>(s_vecSpawns.Base(), s_vecSpawns.Count());
 }
 
 void ZR_Infect(CCSPlayerController *pAttackerController, CCSPlayerController *pVictimController, bool bDontBroadcast)
@@ -1256,11 +1260,11 @@ void ZR_Infect(CCSPlayerController *pAttackerController, CCSPlayerController *pV
 		pZEPlayer->SetInfectState(true);
 
 		ZEPlayerHandle hPlayer = pZEPlayer->GetHandle();
-		new CTimer(g_flMoanInterval + (rand() % 5), false, false, [hPlayer]() { return ZR_MoanTimer(hPlayer); });
+		new CTimer(g_flMoanInterval + (rand() % 5), false, false, TimerOwner_t::Player(hPlayer.GetPlayerSlot()), [hPlayer]() { return ZR_MoanTimer(hPlayer); });
 	}
 }
 
-void ZR_InfectMotherZombie(CCSPlayerController *pVictimController, std::vector<SpawnPoint*> spawns)
+void ZR_InfectMotherZombie(CCSPlayerController *pVictimController, std::span<SpawnPoint*> spawns)
 {
 	CCSPlayerPawn *pVictimPawn = (CCSPlayerPawn*)pVictimController->GetPawn();
 	if (!pVictimPawn)
@@ -1294,7 +1298,7 @@ void ZR_InfectMotherZombie(CCSPlayerController *pVictimController, std::vector<S
 	pZEPlayer->SetInfectState(true);
 
 	ZEPlayerHandle hPlayer = pZEPlayer->GetHandle();
-	new CTimer(g_flMoanInterval + (rand() % 5), false, false, [hPlayer]() { return ZR_MoanTimer(hPlayer); });
+	new CTimer(g_flMoanInterval + (rand() % 5), false, false, TimerOwner_t::Player(hPlayer.GetPlayerSlot()), [hPlayer]() { return ZR_MoanTimer(hPlayer); });
 }
 
 // make players who've been picked as MZ recently less likely to be picked again
@@ -1331,7 +1335,7 @@ void ZR_InitialInfection()
 	bool vecIsMZ[MAXPLAYERS] = { false };
 
 	// get spawn points
-	std::vector<SpawnPoint*> spawns = ZR_GetSpawns();
+	std::span<SpawnPoint*> spawns = ZR_GetSpawns();
 	if (g_iInfectSpawnType == EZRSpawnType::RESPAWN && !spawns.size())
 	{
 		ClientPrintAll(HUD_PRINTTALK, ZR_PREFIX"There are no spawns!");
@@ -1410,20 +1414,16 @@ void ZR_InitialInfection()
 	g_ZRRoundState = EZRRoundState::POST_INFECTION;
 }
 
-void ZR_StartInitialCountdown()
+static CTask ZR_InitialCountdownTask()
 {
-	if (g_iInfectSpawnTimeMin > g_iInfectSpawnTimeMax)
-		V_swap(g_iInfectSpawnTimeMin, g_iInfectSpawnTimeMax);
+	co_await NextTick();
 
-	g_iInfectionCountDown = g_iInfectSpawnTimeMin + (rand() % (g_iInfectSpawnTimeMax - g_iInfectSpawnTimeMin + 1));
-	new CTimer(0.0f, false, false, []()
+	while (g_ZRRoundState == EZRRoundState::ROUND_START)
 	{
-		if (g_ZRRoundState != EZRRoundState::ROUND_START)
-			return -1.0f;
 		if (g_iInfectionCountDown <= 0)
 		{
 			ZR_InitialInfection();
-			return -1.0f;
+			co_return;
 		}
 
 		if (g_iInfectionCountDown <= 60)
@@ -1437,8 +1437,17 @@ void ZR_StartInitialCountdown()
 		}
 		g_iInfectionCountDown--;
 
-		return 1.0f;
-	});
+		co_await Seconds(1.0f);
+	}
+}
+
+void ZR_StartInitialCountdown()
+{
+	if (g_iInfectSpawnTimeMin > g_iInfectSpawnTimeMax)
+		V_swap(g_iInfectSpawnTimeMin, g_iInfectSpawnTimeMax);
+
+	g_iInfectionCountDown = g_iInfectSpawnTimeMin + (rand() % (g_iInfectSpawnTimeMax - g_iInfectSpawnTimeMin + 1));
+	ZR_InitialCountdownTask();
 }
 
 bool ZR_Hook_OnTakeDamage_Alive(CTakeDamageInfo *pInfo, CCSPlayerPawn *pVictimPawn)
@@ -1538,7 +1547,7 @@ void SpawnPlayer(CCSPlayerController* pController)
 	}
 
 	CHandle<CCSPlayerController> handle = pController->GetHandle();
-	new CTimer(2.0f, false, false, [handle]()
+	new CTimer(2.0f, false, false, TimerOwner_t::Player(pController->GetPlayerSlot()), [handle]()
 	{
 		CCSPlayerController* pController = (CCSPlayerController*)handle.Get();
 		if (!pController || !g_bRespawnEnabled || pController->m_iTeamNum < CS_TEAM_T)
@@ -1608,7 +1617,7 @@ void ZR_OnPlayerDeath(IGameEvent* pEvent)
 
 	// respawn player
 	CHandle<CCSPlayerController> handle = pVictimController->GetHandle();
-	new CTimer(g_flRespawnDelay < 0.0f ? 2.0f : g_flRespawnDelay, false, false, [handle]()
+	new CTimer(g_flRespawnDelay < 0.0f ? 2.0f : g_flRespawnDelay, false, false, TimerOwner_t::Player(pVictimController->GetPlayerSlot()), [handle]()
 	{
 		CCSPlayerController* pController = (CCSPlayerController*)handle.Get();
 		if (!pController || !g_bRespawnEnabled || pController->m_iTeamNum < CS_TEAM_T)
@@ -1736,6 +1745,32 @@ void ZR_EndRoundAndAddTeamScore(int iTeamNum)
 	}
 }
 
+static CTask ZR_ZteleTask(CHandle<SpawnPoint> spawnHandle, CHandle<CCSPlayerPawn> pawnHandle, Vector initialpos)
+{
+	co_await Seconds(5.0f, false, TimerOwner_t::Entity(pawnHandle.ToInt()));
+
+	CCSPlayerPawn* pPawn = pawnHandle.Get();
+	SpawnPoint* pSpawn = spawnHandle.Get();
+
+	if (!pPawn || !pSpawn)
+		co_return;
+
+	Vector endpos = pPawn->GetAbsOrigin();
+
+	if (initialpos.DistTo(endpos) < g_flMaxZteleDistance)
+	{
+		Vector origin = pSpawn->GetAbsOrigin();
+		QAngle rotation = pSpawn->GetAbsRotation();
+
+		pPawn->Teleport(&origin, &rotation, nullptr);
+		ClientPrint(pPawn->GetOriginalController(), HUD_PRINTTALK, ZR_PREFIX "\xE4\xBD\xA0\xE5\xB7\xB2\xE8\xA2\xAB\xE4\xBC\xA0\xE9\x80\x81.");
+	}
+	else
+	{
+		ClientPrint(pPawn->GetOriginalController(), HUD_PRINTTALK, ZR_PREFIX "\xE4\xBC\xA0\xE9\x80\x81\xE5\xA4\xB1\xE8\xB4\xA5\xEF\xBC\x81\xE4\xBD\xA0\xE8\xB5\xB0\xE5\xBE\x97\xE5\xA4\xAA\xE8\xBF\x9C\xE4\xBA\x86.");
+	}
+}
+
 CON_COMMAND_CHAT(ztele, "- \xE5\x83\xB5\xE5\xB0\xB8\xE8\xA2\xAB\xE5\x8D\xA1\xE4\xBD\x8F\xE5\x8F\xAF\xE4\xBB\xA5\xE8\xBE\x93\xE8\xBF\x99\xE4\xB8\xAA\xE4\xBC\xA0\xE9\x80\x81")
 {
 	// Silently return so the command is completely hidden
@@ -1755,7 +1790,7 @@ CON_COMMAND_CHAT(ztele, "- \xE5\x83\xB5\xE5\xB0\xB8\xE8\xA2\xAB\xE5\x8D\xA1\xE4\
 		return;
 	}
 
-	std::vector<SpawnPoint*> spawns = ZR_GetSpawns();
+	std::span<SpawnPoint*> spawns = ZR_GetSpawns();
 	if (!spawns.size())
 	{
 		ClientPrint(player, HUD_PRINTTALK, ZR_PREFIX"There are no spawns!");
@@ -1785,31 +1820,7 @@ CON_COMMAND_CHAT(ztele, "- \xE5\x83\xB5\xE5\xB0\xB8\xE8\xA2\xAB\xE5\x8D\xA1\xE4\
 
 	CHandle<CCSPlayerPawn> pawnHandle = pPawn->GetHandle();
 
-	new CTimer(5.0f, false, false, [spawnHandle, pawnHandle, initialpos]()
-	{
-		CCSPlayerPawn* pPawn = pawnHandle.Get();
-		SpawnPoint* pSpawn = spawnHandle.Get();
-
-		if (!pPawn || !pSpawn)
-			return -1.0f;
-
-		Vector endpos = pPawn->GetAbsOrigin();
-
-		if (initialpos.DistTo(endpos) < g_flMaxZteleDistance)
-		{
-			Vector origin = pSpawn->GetAbsOrigin();
-			QAngle rotation = pSpawn->GetAbsRotation();
-
-			pPawn->Teleport(&origin, &rotation, nullptr);
-			ClientPrint(pPawn->GetOriginalController(), HUD_PRINTTALK, ZR_PREFIX "\xE4\xBD\xA0\xE5\xB7\xB2\xE8\xA2\xAB\xE4\xBC\xA0\xE9\x80\x81.");
-		}
-		else
-		{
-			ClientPrint(pPawn->GetOriginalController(), HUD_PRINTTALK, ZR_PREFIX "\xE4\xBC\xA0\xE9\x80\x81\xE5\xA4\xB1\xE8\xB4\xA5\xEF\xBC\x81\xE4\xBD\xA0\xE8\xB5\xB0\xE5\xBE\x97\xE5\xA4\xAA\xE8\xBF\x9C\xE4\xBA\x86.");
-		}
-
-		return -1.0f;
-	});
+	ZR_ZteleTask(spawnHandle, pawnHandle, initialpos);
 }
 
 CON_COMMAND_CHAT(zclass, "<teamname/class name/number> - find and select your Z:R classes")
@@ -1917,7 +1928,7 @@ CON_COMMAND_CHAT_FLAGS(infect, "\xE6\x84\x9F\xE6\x9F\x93\xE7\x8E\xA9\xE5\xAE\xB6
 	}
 
 	const char* pszCommandPlayerName = player ? player->GetPlayerName() : "Console";
-	std::vector<SpawnPoint*> spawns = ZR_GetSpawns();
+	std::span<SpawnPoint*> spawns = ZR_GetSpawns();
 
 	if (g_iInfectSpawnType == EZRSpawnType::RESPAWN && !spawns.size())
 	{